@@ -51,6 +51,7 @@ PYBIND11_MODULE(c_clause, m) {
             },
             py::arg("direction"), py::arg("as_string")
         )
+        .def("get_certified_stop_stats", &RankingHandler::getCertifiedStopStats)
     ; //class end
     // QAHandler()
     py::class_<QAHandler>(m, "QAHandler") 
@@ -95,6 +96,7 @@ PYBIND11_MODULE(c_clause, m) {
             py::arg("as_string")
         )
         .def("write_rules", &QAHandler::writeRules, py::arg("path"), py::arg("as_string"))
+        .def("get_certified_stop_stats", &QAHandler::getCertifiedStopStats)
         .def("set_options", &QAHandler::setOptions)
     ; //class end
     // RulesHandler()
@@ -160,6 +162,46 @@ PYBIND11_MODULE(c_clause, m) {
             [](Loader &self, const TripleSet &data, const TripleSet &filter, const TripleSet &target) { return self.loadData<TripleSet>(data, filter, target); }, 
             py::arg("data"), py::arg("filter") = TripleSet(), py::arg("target") = TripleSet()
         )
+        .def(
+            "add_data",
+            [](Loader &self, const std::string &data) { return self.addData<std::string>(data); },
+            py::arg("data"),
+            R"pbdoc(Adds triples to the loaded data, they are used by all handlers right away. New entities and relations are added to the index.)pbdoc"
+        )
+        .def(
+            "add_data",
+            [](Loader &self, const StringTripleSet &data) { return self.addData<StringTripleSet>(data); },
+            py::arg("data")
+        )
+        .def(
+            "add_data",
+            [](Loader &self, const TripleSet &data) { return self.addData<TripleSet>(data); },
+            py::arg("data")
+        )
+        .def(
+            "compact", &Loader::compactData,
+            R"pbdoc(Merges the triples added with add_data into the data representation. This happens in the background every compaction_threshold added triples.)pbdoc"
+        )
+        .def(
+            "write_snapshot", &Loader::writeSnapshot, py::arg("path"),
+            R"pbdoc(Writes the loaded data (index, data, filter, target) into a binary snapshot that can be loaded with load_snapshot.)pbdoc"
+        )
+        .def(
+            "load_snapshot", &Loader::loadSnapshot, py::arg("path"),
+            R"pbdoc(Loads data from a snapshot written with write_snapshot instead of load_data. The file is memory mapped and can be shared between processes.)pbdoc"
+        )
+        .def(
+            "publish_shared", &Loader::publishShared, py::arg("name"),
+            R"pbdoc(Puts the loaded data into the shared memory segment name such that other processes can use it with attach_shared without a copy. The segment is removed when the last loader that uses it is gone.)pbdoc"
+        )
+        .def(
+            "attach_shared", &Loader::attachShared, py::arg("name"),
+            R"pbdoc(Uses the data published with publish_shared (in any process on this machine) instead of load_data.)pbdoc"
+        )
+        .def_static(
+            "remove_shared", &Loader::removeShared, py::arg("name"),
+            R"pbdoc(Removes the shared memory segment name, only needed when the publishing process was killed.)pbdoc"
+        )
         .def("get_entity_index", &Loader::getNodeToIdx)
         .def("write_rules", &Loader::writeRules, py::arg("path"), R"pbdoc(Writes rules after loading. Can be used to store subsets, e.g., load rules ignoring B-rules and then write.)pbdoc")
         .def("get_rules", &Loader::getRuleLines, R"pbdoc(Returns rules after loading. Returns a list of strings: 'num_preds\t\support\tconf\trulestring'.)pbdoc")
@@ -0,0 +1,49 @@
+from c_clause import RankingHandler, QAHandler, Loader
+from clause.util.utils import get_base_dir
+from clause import Options
+import time
+
+# ** Benchmark of the loader option entity_order **
+# the entities get new internal ids such that connected entities are close in memory,
+# the results (and all ids and strings of the api) are the same for every order
+
+train = f"{get_base_dir()}/data/wnrr/train.txt"
+filter_set = f"{get_base_dir()}/data/wnrr/valid.txt"
+target = f"{get_base_dir()}/data/wnrr/test.txt"
+rules = f"{get_base_dir()}/data/wnrr/anyburl-rules-c5-3600"
+
+repetitions = 3
+
+options = Options()
+options.set("loader.verbose", False)
+options.set("ranking_handler.verbose", False)
+options.set("ranking_handler.topk", 100)
+options.set("qa_handler.verbose", False)
+
+reference = None
+for order in ["none", "degree", "bfs", "rcm"]:
+    options.set("loader.entity_order", order)
+    loader = Loader(options=options.get("loader"))
+    start = time.time()
+    loader.load_data(data=train, filter=filter_set, target=target)
+    load_time = time.time() - start
+    loader.load_rules(rules=rules)
+
+    ranker = RankingHandler(options=options.get("ranking_handler"))
+    rank_times = []
+    for _ in range(repetitions):
+        start = time.time()
+        ranker.calculate_ranking(loader=loader)
+        rank_times.append(time.time() - start)
+    ranking = ranker.get_ranking(direction="tail", as_string=True)
+    num_queries = sum(len(queries) for queries in ranking.values()) * 2
+
+    if reference is None:
+        reference = ranking
+    assert ranking == reference, "The ranking depends on the entity order."
+
+    best = min(rank_times)
+    print(
+        f"entity_order={order:7} load: {load_time:.2f}s  ranking: {best:.2f}s "
+        f"({num_queries / best:.0f} queries/s, best of {repetitions})"
+    )
@@ -2,6 +2,7 @@ from setuptools import setup, Extension, find_packages, find_namespace_packages
 from setuptools.command.build_ext import build_ext
 
 import setuptools
+import sys
 import pybind11
 from glob import glob
 import shutil
@@ -53,6 +54,8 @@ class BuildExt(build_ext):
     for ext in self.extensions:
       ext.extra_compile_args = opts
       ext.extra_link_args = ["-fopenmp"] # assumes openmp is supported
+      if sys.platform.startswith("linux"):
+        ext.extra_link_args.append("-lrt") # shm_open on older glibc
     build_ext.build_extensions(self)
 
 ext_modules = [
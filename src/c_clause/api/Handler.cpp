@@ -33,6 +33,9 @@ void BackendHandler::setRankingOptions(std::map<std::string, std::string> option
         {"num_threads", [&ranker](std::string val) { ranker.setNumThr(std::stoi(val)); }},
         {"adapt_topk", [&ranker](std::string val) { ranker.setAdaptTopK(util::stringToBool(val)); }},
         {"queryTopK", [&ranker](std::string val) { ranker.setQueryTopK(std::stoi(val)); }},
+        {"cache_size_mb", [&ranker](std::string val) { ranker.setCacheSizeMB(std::stod(val)); }},
+        {"certified_stop", [&ranker](std::string val) { ranker.setCertifiedStop(util::stringToBool(val)); }},
+        {"full_ranking", [&ranker](std::string val) { ranker.setFullRanking(util::stringToBool(val)); }},
 
     };
 
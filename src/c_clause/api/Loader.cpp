@@ -1,4 +1,5 @@
 #include "Loader.h"
+#include "../core/TripleReader.h"
 
 #include <functional>
 #include <fstream>
@@ -22,6 +23,12 @@
     rules = std::make_unique<RuleStorage>(index, ruleFactory);
  }
 
+Loader::~Loader(){
+    if (compaction.joinable()){
+        compaction.join();
+    }
+}
+
 bool Loader::getLoadedData(){
     return loadedData;
 }
@@ -36,6 +43,153 @@ void Loader::setOptions(std::map<std::string, std::string> options){
 }
 
 
+void Loader::writeSnapshot(std::string path){
+    if (!loadedData){
+        throw std::runtime_error("You have to load data first before you can write a snapshot.");
+    }
+    // the snapshot only contains CSRs
+    compactData();
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw  std::runtime_error("Failed to create file. Please check if the paths are correct: " + path);
+    }
+    writeSnapshotData(file);
+    if (!file.good()){
+        throw std::runtime_error("Failed to write snapshot: " + path);
+    }
+    file.close();
+}
+
+
+void Loader::writeSnapshotData(std::ostream& out){
+    snapshot::writeHeader(out);
+    index->write(out);
+    data->write(out);
+    filter->write(out);
+    target->write(out);
+}
+
+
+void Loader::readSnapshotData(std::shared_ptr<util::MappedFile> file){
+    snapshot::Reader reader(file->data(), file->size());
+    snapshot::checkHeader(reader);
+    index->read(reader, file);
+    data->read(reader, file);
+    filter->read(reader, file);
+    target->read(reader, file);
+}
+
+
+void Loader::loadSnapshot(std::string path){
+    if (this->loadedData){
+        throw std::runtime_error("Please load the data only once or use a new data handler.");
+    }
+    if (verbose){
+        std::cout<< "Loading snapshot..." << "\n";
+    }
+    readSnapshotData(std::make_shared<util::MappedFile>(path));
+    this->loadedData = true;
+    if (verbose){
+        std::cout<<"Loaded snapshot."<<std::endl;
+    }
+}
+
+
+void Loader::publishShared(std::string name){
+    if (!loadedData){
+        throw std::runtime_error("You have to load data first before you can publish it.");
+    }
+    std::unique_lock<std::shared_timed_mutex> lock = writeLock();
+    mergeDelta();
+    std::shared_ptr<SharedMemory> segment = SharedMemory::publish(name, [this](std::ostream& out){ writeSnapshotData(out); });
+    // the own copy of the data is replaced by the segment, the ids do not change
+    readSnapshotData(segment);
+    shared = segment;
+    // the data got a new version with the segment, the index is built only now
+    indexRules();
+    if (verbose){
+        std::cout<<"Published data to shared memory "<<name<<" ("<<segment->size()<<" bytes)."<<std::endl;
+    }
+}
+
+
+void Loader::attachShared(std::string name){
+    if (this->loadedData){
+        throw std::runtime_error("Please load the data only once or use a new data handler.");
+    }
+    std::shared_ptr<SharedMemory> segment = SharedMemory::attach(name);
+    readSnapshotData(segment);
+    shared = segment;
+    this->loadedData = true;
+    if (verbose){
+        std::cout<<"Attached to shared memory "<<name<<"."<<std::endl;
+    }
+}
+
+
+void Loader::removeShared(std::string name){
+    SharedMemory::remove(name);
+}
+
+
+// building the CSR is the expensive part, queries (shared lock) and addData() continue meanwhile
+void Loader::compact(){
+    std::unique_ptr<RelationalCSR> compacted = data->buildCompacted();
+    std::unique_lock<std::shared_timed_mutex> lock(dataMutex);
+    data->swapCompacted(std::move(compacted));
+}
+
+
+void Loader::compactData(){
+    if (!loadedData){
+        throw std::runtime_error("You have to load data first before you can compact it.");
+    }
+    std::unique_lock<std::shared_timed_mutex> lock = writeLock();
+    mergeDelta();
+    indexRules();
+}
+
+
+std::unique_lock<std::shared_timed_mutex> Loader::writeLock(){
+    if (compaction.joinable()){
+        compaction.join();
+    }
+    return std::unique_lock<std::shared_timed_mutex>(dataMutex);
+}
+
+
+void Loader::mergeDelta(){
+    data->freezeDelta();
+    data->swapCompacted(data->buildCompacted());
+}
+
+
+// a compaction must not swap the CSR while the index reads it
+void Loader::buildRuleIndex(){
+    if (!dBodyIndex || !loadedRules){
+        return;
+    }
+    std::unique_lock<std::shared_timed_mutex> lock = writeLock();
+    indexRules();
+}
+
+
+void Loader::indexRules(){
+    if (!dBodyIndex || !loadedRules){
+        return;
+    }
+    if (verbose){
+        std::cout<<"Building the body index of the U_d rules..."<<std::endl;
+    }
+    rules->buildBodyIndex(*data, numThr);
+}
+
+
+std::shared_lock<std::shared_timed_mutex> Loader::readLock(){
+    return std::shared_lock<std::shared_timed_mutex>(dataMutex);
+}
+
+
 void Loader::loadRules(std::string path){
     rules->clearAll();
     if (!loadedData){
@@ -47,6 +201,7 @@ void Loader::loadRules(std::string path){
         rules->readAnyTimeParFormat(path, false, this->numThr);
     }
     loadedRules = true;
+    buildRuleIndex();
 }
 
 
@@ -57,6 +212,7 @@ void Loader::loadRules(std::vector<std::string> ruleStrings){
     }
     rules->readAnyTimeFromVec(ruleStrings, false);
     loadedRules = true;
+    buildRuleIndex();
 }
 
 
@@ -67,6 +223,7 @@ void Loader::loadRules(std::vector<std::string> ruleStrings, std::vector<std::pa
     }
     rules->readAnyTimeFromVecs(ruleStrings, ruleStats, false);
     loadedRules = true;
+    buildRuleIndex();
 }
 
 
@@ -112,12 +269,12 @@ std::vector<std::string> Loader::getRuleLines(){
 }
 
 
-std::unordered_map<std::string, int>& Loader::getNodeToIdx(){
+std::unordered_map<std::string, int> Loader::getNodeToIdx(){
     return index->getNodeToIdx();
 }
 
 
-std::unordered_map<std::string, int>& Loader::getRelationToIdx(){
+std::unordered_map<std::string, int> Loader::getRelationToIdx(){
     return index->getRelationToIdx();
 }
 
@@ -169,6 +326,7 @@ void Loader::setRuleOptions(std::map<std::string, std::string> options, RuleFact
         {"d_min_preds", [&ruleFactory](std::string val) {ruleFactory.setMinPred(std::stoi(val), "d");}},
         {"d_min_conf", [&ruleFactory](std::string val) {ruleFactory.setMinConf(std::stod(val), "d");}},
         {"d_max_length", [&ruleFactory](std::string val) {ruleFactory.setDmaxLength(std::stoi(val));}},
+        {"d_body_index", [this](std::string val) {this->dBodyIndex = util::stringToBool(val);}},
         // XXc
         {"load_u_xxc_rules", [&ruleFactory](std::string val) {ruleFactory.setCreateRuleXXc(util::stringToBool(val));}},
         {"xxc_num_unseen", [&ruleFactory](std::string val) {ruleFactory.setNumUnseen(std::stoi(val), "xxc");}},
@@ -189,6 +347,14 @@ void Loader::setRuleOptions(std::map<std::string, std::string> options, RuleFact
         {"combo_min_conf", [&ruleFactory](std::string val) {ruleFactory.setMinConf(std::stod(val), "m");}},
         // other
         {"num_threads", [this](std::string val) {this->setNumThreads(std::stoi(val));}},
+        {"compaction_threshold", [this](std::string val) {this->compactionThreshold = std::stoi(val);}},
+        {"entity_order", [this](std::string val) {
+            if (val != "none" && val != "degree" && val != "bfs" && val != "rcm"){
+                throw std::runtime_error("Entity order '" + val + "' is not known. Please choose from 'none', 'degree', 'bfs' or 'rcm'.");
+            }
+            this->entityOrder = val;
+        }},
+        {"compress_data", [this](std::string val) {this->data->setCompressed(util::stringToBool(val));}},
         
     };
 
@@ -206,6 +372,7 @@ void Loader::setRuleOptions(std::map<std::string, std::string> options, RuleFact
 
 void Loader::updateRules(){
     ruleFactory->updateRules(rules->getRules(), rules->getRelToRules());
+    rules->sortRelRules();
 }
 
 std::vector<std::string> Loader::getRuleIdx(){
@@ -250,41 +417,26 @@ std::shared_ptr<Index> Loader::getIndex(){
     return index;
 }
 
+// the order is computed on data only, entities that only occur in filter or target are placed like isolated ones
+void Loader::relabelEntities(){
+    std::vector<int> order = entityorder::compute(entityOrder, index->getNodeSize(), data->getPending());
+    std::vector<int> newIds(order.size());
+    for (int i=0; i<order.size(); i++){
+        newIds[order[i]] = i;
+    }
+    index->permuteNodes(order);
+    data->relabelPending(newIds);
+    filter->relabelPending(newIds);
+    target->relabelPending(newIds);
+}
+
 // loads a file with tab separated string (token) triples
 std::unique_ptr<std::vector<Triple>> Loader::loadTriplesToVec(std::string path){
-
     auto triples = std::make_unique<std::vector<Triple>>();
-
-    // Open the file
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file: " + path);
-    }
-
-    // Read the file line by line
-    std::string line;
-
-
-    while (!util::safeGetline(file, line).eof()){
-		std::istringstream iss(line);
-		std::vector<std::string> results = util::split(line, '\t');
-		if (results.size() != 3) {
-			throw std::runtime_error("Error while reading a file with Triples please check that every line follows tab separeated: head relation tail format. ");
-		}
-		Triple triple;
-        //TODO catch error here when unseen entity appears; for more informative error handling
-        triple[0] = index->getIdOfNodestring(results[0]);
-        triple[1] = index->getIdOfRelationstring(results[1]);
-        triple[2] = index->getIdOfNodestring(results[2]);
-
-        if (!iss.fail() || iss.eof()) {
-            triples->push_back(triple);
-        }else{
-            throw std::runtime_error("Error while reading a file with Triples please check that every line follows tab separeated: head relation tail format. ");
-        }
-	}
-	file.close();
-    return std::move(triples);
+    TripleReader reader(numThr);
+    // throws for entities and relations that are not in the index and for lines without exactly 3 columns
+    reader.read(path, *index, *triples, false, true);
+    return triples;
 }
 
 
@@ -311,6 +463,9 @@ void Loader::setNumThreads(int num){
     }else{
         numThr = num;
     }
+    data->setNumThreads(numThr);
+    filter->setNumThreads(numThr);
+    target->setNumThreads(numThr);
 }
 
 
@@ -15,10 +15,15 @@
 #include "../core/Index.h"
 #include "../core/Util.hpp"
 #include "../core/Types.h"
+#include "../core/EntityOrder.h"
+#include "../core/SharedMemory.h"
 
 #include <array>
 #include <vector>
 #include <string>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
 #include <omp.h>
 
 
@@ -27,9 +32,28 @@
 class Loader{
 public:
     Loader(std::map<std::string, std::string> options);
+    ~Loader();
 
     template<class T>
     void loadData(T data, T filter, T target);
+    // adds triples to the loaded data, they can be queried directly (see TripleStorage::loadDelta())
+    // when compaction_threshold triples were added they are merged into the CSR in the background
+    template<class T>
+    void addData(T data);
+    // merges all added triples into the CSR (blocking)
+    void compactData();
+    // handlers hold it while they use the data such that a compaction is not swapped in meanwhile
+    std::shared_lock<std::shared_timed_mutex> readLock();
+    // binary snapshot of index, data, filter and target (see core/Snapshot.hpp)
+    // loading maps the file read-only, the CSR arrays are used in place
+    void writeSnapshot(std::string path);
+    void loadSnapshot(std::string path);
+    // the snapshot in a shared memory segment (see core/SharedMemory.h) such that worker processes use one copy of the data
+    // the publishing loader switches to the segment as well, the segment is removed when the last loader that uses it is gone
+    void publishShared(std::string name);
+    void attachShared(std::string name);
+    // only needed for segments that were left behind by processes that were killed
+    static void removeShared(std::string name);
 
     void loadRules(std::string rulePath);
     void loadRules(std::vector<std::string> ruleStatsStrings);
@@ -38,8 +62,8 @@ public:
     void writeRules(std::string path);
     std::vector<std::string> getRuleLines();
     
-    std::unordered_map<std::string, int>& getNodeToIdx();
-	std::unordered_map<std::string, int>& getRelationToIdx();
+    std::unordered_map<std::string, int> getNodeToIdx();
+	std::unordered_map<std::string, int> getRelationToIdx();
     void subsEntityStrings(std::map<std::string, std::string>& newNames);
     void subsRelationStrings(std::map<std::string, std::string>& newNames);
     std::vector<std::string> getRuleIdx();
@@ -82,7 +106,35 @@ private:
 
     bool verbose = true;
 
+    void writeSnapshotData(std::ostream& out);
+    void readSnapshotData(std::shared_ptr<util::MappedFile> file);
+    // keeps the segment referenced while the data is used
+    std::shared_ptr<SharedMemory> shared;
+
     int numThr=1;
+
+    // entities get new internal ids before the CSRs are built (see EntityOrder.h), "none" keeps the ids
+    std::string entityOrder = "none";
+    void relabelEntities();
+
+    // U_d rules precompute the entities that satisfy their body (see RuleD::buildBodyIndex())
+    // when rules are loaded, after compactData() and publishShared(); triples added in between are searched as usual
+    bool dBodyIndex = false;
+    // waits for a running compaction and builds the index under the unique lock of the data
+    void buildRuleIndex();
+    // same but the caller holds the lock (see writeLock())
+    void indexRules();
+
+    // a compaction is started when the data has this many added triples, -1 for off
+    int compactionThreshold = 100000;
+    std::thread compaction;
+    std::shared_timed_mutex dataMutex;
+    // runs in the compaction thread
+    void compact();
+    // joins a running compaction (it takes the lock itself), then excludes queries and addData()
+    std::unique_lock<std::shared_timed_mutex> writeLock();
+    // merges the added triples into the CSR, needs writeLock()
+    void mergeDelta();
 };
 
 template<class T>
@@ -105,13 +157,16 @@ void Loader::loadData(T data, T filter, T target){
         this->target->read(target, false);
     }
     if (filter.size() > 0) {
-        this->filter->read(filter, true); // all data is loaded, we can start loading CSR here
+        this->filter->read(filter, false);
     }
-
-    this->data->loadCSR();
-    if (target.size() > 0) {
-        this->target->loadCSR();
+    if (entityOrder != "none"){
+        relabelEntities();
     }
+    // all data is loaded (and the index is complete), we can start loading CSR here
+    // target and filter get an (empty) CSR also when nothing was loaded so they can be queried
+    this->data->loadCSR();
+    this->target->loadCSR();
+    this->filter->loadCSR();
     this->loadedData = true;
 
     if (verbose){
@@ -119,4 +174,24 @@ void Loader::loadData(T data, T filter, T target){
     }
 };
 
+template<class T>
+void Loader::addData(T data){
+    if (!this->loadedData){
+        throw std::runtime_error("Please load data first before you add triples.");
+    }
+    std::unique_lock<std::shared_timed_mutex> lock(dataMutex);
+    this->data->read(data, false);
+    this->data->loadDelta();
+
+    // at most one compaction runs at a time, the triples added meanwhile wait for the next one
+    if (compactionThreshold > 0 && this->data->getDeltaSize() >= compactionThreshold && !this->data->isCompacting()){
+        // the last compaction swapped already, only the thread is left
+        if (compaction.joinable()){
+            compaction.join();
+        }
+        this->data->freezeDelta();
+        compaction = std::thread(&Loader::compact, this);
+    }
+};
+
 #endif
\ No newline at end of file
@@ -47,6 +47,11 @@ void PredictionHandler::scoreTriples(std::vector<std::array<int, 3>> triples,  s
     }
     scorer.clearAll();
     index = dHandler->getIndex();
+    for (auto& triple: triples){
+        triple[0] = index->toInternalNode(triple[0]);
+        triple[2] = index->toInternalNode(triple[2]);
+    }
+    auto lock = dHandler->readLock();
     scorer.calculateTripleScores(triples, dHandler->getData(), dHandler->getRules());
 }
 
@@ -79,6 +84,7 @@ void PredictionHandler::scoreTriples(std::vector<std::array<std::string, 3>> tri
        }
 
     }
+    auto lock = dHandler->readLock();
     scorer.calculateTripleScores(idxTriples, dHandler->getData(), dHandler->getRules());
 }
 
@@ -88,12 +94,18 @@ void PredictionHandler::scoreTriples(std::string path,  std::shared_ptr<Loader>
     triples = dHandler->loadTriplesToVec(path);
     scorer.clearAll();
     index = dHandler->getIndex();
+    auto lock = dHandler->readLock();
     scorer.calculateTripleScores(*triples, dHandler->getData(), dHandler->getRules());
 }
 
 
 std::vector<std::array<double, 4 >> PredictionHandler::getIdxScores(){
-    return scorer.getTripleScores();
+    std::vector<std::array<double, 4>> scores = scorer.getTripleScores();
+    for (std::array<double, 4>& arr: scores){
+        arr[0] = index->toExternalNode((int) arr[0]);
+        arr[2] = index->toExternalNode((int) arr[2]);
+    }
+    return scores;
 }
 
 
@@ -129,9 +141,9 @@ void PredictionHandler::writeScores(std::string& path, bool asString){
         int irel = static_cast<int>(scores[i][1]);
         int itail = static_cast<int>(scores[i][2]);
 
-        std::string head = asString ? index->getStringOfNodeId(ihead) : std::to_string(ihead);
+        std::string head = asString ? index->getStringOfNodeId(ihead) : std::to_string(index->toExternalNode(ihead));
         std::string rel = asString ? index->getStringOfRelId(irel)   : std::to_string(irel);
-        std::string tail = asString ? index->getStringOfNodeId(itail) : std::to_string(itail);
+        std::string tail = asString ? index->getStringOfNodeId(itail) : std::to_string(index->toExternalNode(itail));
         std::string score = std::to_string(scores[i][3]);
 
         file << head + "\t" + rel + "\t" + tail + "\t" + score;
@@ -213,7 +225,7 @@ std::tuple<std::vector<std::array<int,3>>, std::vector<std::vector<int>>,  std::
     for (int i=0; i<trGroundings.size(); i++){
         std::pair<Triple, RuleGroundings>& el = trGroundings[i];
         Triple triple = el.first;
-        targets.push_back({triple[0], triple[1], triple[2]});
+        targets.push_back({index->toExternalNode(triple[0]), triple[1], index->toExternalNode(triple[2])});
         RuleGroundings& elGroundings = el.second;
         std::vector<int> rulesPerTarget;
         std::vector<std::vector<std::vector<std::array<int, 3>>>> expPerTarget;
@@ -222,7 +234,13 @@ std::tuple<std::vector<std::array<int,3>>, std::vector<std::vector<int>>,  std::
             Rule* rule = pair.first;
             rulesPerTarget.push_back(rule->getID());
             // groundings for the rule
-            std::vector<std::vector<Triple>>& explanations = pair.second;
+            std::vector<std::vector<Triple>> explanations = pair.second;
+            for (std::vector<Triple>& ruleExp: explanations){
+                for (Triple& tri: ruleExp){
+                    tri[0] = index->toExternalNode(tri[0]);
+                    tri[2] = index->toExternalNode(tri[2]);
+                }
+            }
             expPerTarget.push_back(explanations);
         }
         groundings.push_back(expPerTarget);
@@ -253,9 +271,9 @@ void PredictionHandler::writeExplanations(std::string& outputPath, bool asString
         Triple triple = el.first;
 
 
-        std::string head = asString ? "\"" + index->getStringOfNodeId(triple[0]) + "\"" : std::to_string(triple[0]);
+        std::string head = asString ? "\"" + index->getStringOfNodeId(triple[0]) + "\"" : std::to_string(index->toExternalNode(triple[0]));
         std::string rel = asString ? "\"" + index->getStringOfRelId(triple[1]) + "\"" : std::to_string(triple[1]);
-        std::string tail = asString ? "\"" + index->getStringOfNodeId(triple[2]) + "\"" : std::to_string(triple[2]);
+        std::string tail = asString ? "\"" + index->getStringOfNodeId(triple[2]) + "\"" : std::to_string(index->toExternalNode(triple[2]));
 
         file <<"\"target\":";
         file<<"[" + head + "," + rel + "," + tail + "]" + ",";
@@ -316,9 +334,9 @@ std::string PredictionHandler::groundingsToString(std::vector<std::vector<Triple
         json += "[";
 
         for (size_t j = 0; j < groundings[i].size(); ++j) {
-            std::string head = asString ? "\"" + index->getStringOfNodeId(groundings[i][j][0]) + "\"" : std::to_string(groundings[i][j][0]);
+            std::string head = asString ? "\"" + index->getStringOfNodeId(groundings[i][j][0]) + "\"" : std::to_string(index->toExternalNode(groundings[i][j][0]));
             std::string rel = asString ? "\"" + index->getStringOfRelId(groundings[i][j][1]) + "\"" : std::to_string(groundings[i][j][1]);
-            std::string tail = asString ? "\"" + index->getStringOfNodeId(groundings[i][j][2]) + "\"" : std::to_string(groundings[i][j][2]);
+            std::string tail = asString ? "\"" + index->getStringOfNodeId(groundings[i][j][2]) + "\"" : std::to_string(index->toExternalNode(groundings[i][j][2]));
 
             json += "[" + head + "," + rel + "," + tail + "]";
 
@@ -54,7 +54,8 @@ void QAHandler::calculate_answers(std::vector<std::pair<std::string, std::string
     index = dHandler->getIndex();
     for (int i=0; i<queries.size(); i++){
         try {
-            intQueries.at(i) = std::make_pair(index->getIdOfNodestring(queries[i].first), index->getIdOfRelationstring(queries[i].second));
+            // the idx version takes the ids of the api
+            intQueries.at(i) = std::make_pair(index->toExternalNode(index->getIdOfNodestring(queries[i].first)), index->getIdOfRelationstring(queries[i].second));
         }
         catch(const std::exception& e){
             throw std::runtime_error(
@@ -70,17 +71,20 @@ void QAHandler::calculate_answers(std::vector<std::pair<std::string, std::string
 
 
 void QAHandler::calculate_answers(std::vector<std::pair<int, int>>& queries, std::shared_ptr<Loader> dHandler, std::string headOrTail){
-    this->queries = queries; // cache queries
-
     if (!dHandler->getLoadedData()){
         throw std::runtime_error("You must load data before you can answer questions.");
     }
     if (!dHandler->getLoadedRules()){
         throw std::runtime_error("You must load rules before you can answer questions.");
     }
+    index = dHandler->getIndex();
+    // cache queries, with the internal entity ids
+    this->queries = queries;
+    for (auto& query: this->queries){
+        query.first = index->toInternalNode(query.first);
+    }
     answers.clear();
     answers.resize(queries.size());
-    index = dHandler->getIndex();
     ranker.clearAll();
     TripleStorage target(index);
     bool isTailQuery;
@@ -93,8 +97,8 @@ void QAHandler::calculate_answers(std::vector<std::pair<int, int>>& queries, std
     }
     //query.first is source entity
     //query.second is relation
-    for (int i=0; i<queries.size(); i++){
-        std::pair<int,int>& query = queries[i];
+    for (int i=0; i<this->queries.size(); i++){
+        std::pair<int,int>& query = this->queries[i];
         isTailQuery ?  target.addIdx(query.first, query.second, 0) : target.addIdx(0, query.second, query.first);
     }
     // note that loadCSR does not break anything for the other CSRs as we only allow already existing idx's (entities and relations)
@@ -104,6 +108,8 @@ void QAHandler::calculate_answers(std::vector<std::pair<int, int>>& queries, std
         // safety measure to bound lifetime of the dHandler which holds the RulesHandler with the rules to this object;
         this->myDHandler = dHandler;
     }
+    // no compaction of the data is swapped in while the answers are calculated
+    auto lock = dHandler->readLock();
     ranker.makeRanking(target, dHandler->getData(), dHandler->getRules(), dHandler->getFilter());
 
     // CandidateConfs is  std::vector<pair<int,double>>
@@ -115,8 +121,8 @@ void QAHandler::calculate_answers(std::vector<std::pair<int, int>>& queries, std
         queryRules.resize(queries.size());
     }
 
-     for (int i=0; i<queries.size(); i++){
-        std::pair<int,int>& query = queries[i];
+     for (int i=0; i<this->queries.size(); i++){
+        std::pair<int,int>& query = this->queries[i];
         // access as candConfs[relation][sourceEntity]
         answers.at(i) = candConfs[query.second][query.first];
         if (collectRules){
@@ -177,7 +183,13 @@ std::vector<std::vector<std::pair<std::string,double>>> QAHandler::getStrAnswers
 
 
 std::vector<std::vector<std::pair<int, double>>> QAHandler::getIdxAnswers(){
-    return answers;
+    std::vector<std::vector<std::pair<int, double>>> idxAnswers = answers;
+    for (auto& queryAnswers: idxAnswers){
+        for (auto& pair: queryAnswers){
+            pair.first = index->toExternalNode(pair.first);
+        }
+    }
+    return idxAnswers;
 }
 
 
@@ -196,7 +208,7 @@ void QAHandler::writeAnswers(std::string outputPath, bool strings){
 
     for (int idx = 0; idx < this->queries.size(); idx++){
         
-        std::string source = strings ? "\"" + index->getStringOfNodeId(this->queries[idx].first) + "\"" : std::to_string(this->queries[idx].first);
+        std::string source = strings ? "\"" + index->getStringOfNodeId(this->queries[idx].first) + "\"" : std::to_string(index->toExternalNode(this->queries[idx].first));
         std::string rel = strings ? "\"" + index->getStringOfRelId(this->queries[idx].second) + "\"" : std::to_string(this->queries[idx].second);
         
         // Collect answers and scores
@@ -204,7 +216,7 @@ void QAHandler::writeAnswers(std::string outputPath, bool strings){
         std::string scores = "";
         auto itr = this->answers[idx].begin();
         for (; itr != this->answers[idx].end(); itr++){
-            answers += strings ? "\"" + index->getStringOfNodeId(itr->first) + "\"" : std::to_string(itr->first);
+            answers += strings ? "\"" + index->getStringOfNodeId(itr->first) + "\"" : std::to_string(index->toExternalNode(itr->first));
             scores += std::to_string(itr->second);
             if (std::next(itr) != this->answers[idx].end()) {
                 answers += ",";
@@ -219,6 +231,10 @@ void QAHandler::writeAnswers(std::string outputPath, bool strings){
 }
 
 
+std::map<std::string, long long> QAHandler::getCertifiedStopStats(){
+    return {{"stopped_queries", ranker.getNumCertifiedStops()}, {"skipped_rules", ranker.getNumSkippedRules()}};
+}
+
 std::vector<std::vector<std::vector<int>>> QAHandler::getIdxRules(){
     if (!collectRules){
         throw std::runtime_error("Please set 'qa_handler.collect_rules' to true before you calculate answers");
@@ -272,14 +288,14 @@ void QAHandler::writeRules(std::string outputPath, bool strings){
 
     for (int idx = 0; idx < this->queries.size(); idx++){
         
-        std::string source = strings ? "\"" + index->getStringOfNodeId(this->queries[idx].first) + "\"" : std::to_string(this->queries[idx].first);
+        std::string source = strings ? "\"" + index->getStringOfNodeId(this->queries[idx].first) + "\"" : std::to_string(index->toExternalNode(this->queries[idx].first));
         std::string rel = strings ? "\"" + index->getStringOfRelId(this->queries[idx].second) + "\"" : std::to_string(this->queries[idx].second);
         
         // Collect answers and scores
         std::string answers = "";
         auto itr = this->answers[idx].begin();
         for (; itr != this->answers[idx].end(); itr++){
-            answers += strings ? "\"" + index->getStringOfNodeId(itr->first) + "\"" : std::to_string(itr->first);
+            answers += strings ? "\"" + index->getStringOfNodeId(itr->first) + "\"" : std::to_string(index->toExternalNode(itr->first));
             if (std::next(itr) != this->answers[idx].end()) {
                 answers += ",";
             }
@@ -22,6 +22,8 @@ public:
 
     void writeAnswers(std::string outputPath, bool strings);
     void writeRules(std::string outputPath, bool strings);
+    // "stopped_queries" and "skipped_rules" of the last calculate_answers with certified_stop
+    std::map<std::string, long long> getCertifiedStopStats();
     
     void setOptions(std::map<std::string, std::string> options);
     void setOptionsFrontend(std::map<std::string, std::string> options);
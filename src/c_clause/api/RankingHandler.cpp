@@ -53,9 +53,14 @@ void RankingHandler::calculateRanking(std::shared_ptr<Loader> dHandler){
         // bind lifetime of rules to this object
         myDhandler = dHandler;
     }
+    auto lock = dHandler->readLock();
     ranker.makeRanking(dHandler->getTarget(), dHandler->getData(), dHandler->getRules(),dHandler->getFilter());
 }
 
+std::map<std::string, long long> RankingHandler::getCertifiedStopStats(){
+    return {{"stopped_queries", ranker.getNumCertifiedStops()}, {"skipped_rules", ranker.getNumSkippedRules()}};
+}
+
 
 void RankingHandler::writeRanking(std::string writePath, std::shared_ptr<Loader> dHandler){
     ranker.writeRanking(dHandler->getTarget(), writePath);
@@ -72,13 +77,23 @@ void RankingHandler::writeRules(std::string writePath, std::shared_ptr<Loader> d
 
 
 std::unordered_map<int,std::unordered_map<int,std::vector<std::pair<int, double>>>> RankingHandler::getRanking(std::string headOrTail){
-    if (headOrTail=="head"){
-        return ranker.getHeadQcandsConfs();
-    }else if (headOrTail=="tail"){
-        return ranker.getTailQcandsConfs();
-    }else{
+    if (!(headOrTail =="head") && !(headOrTail =="tail")){
         throw std::runtime_error("Please specify 'head' or 'tail' as first argument of getRanking");
     }
+    auto& idxRanking = (headOrTail == "head") ? ranker.getHeadQcandsConfs() : ranker.getTailQcandsConfs();
+    // the entities get the ids of the api
+    std::unordered_map<int,std::unordered_map<int,std::vector<std::pair<int, double>>>> ranking;
+    for (const auto& outer_pair : idxRanking) {
+        auto& relRanking = ranking[outer_pair.first];
+        for (const auto& middle_pair : outer_pair.second) {
+            std::vector<std::pair<int, double>>& pairsVec = relRanking[index->toExternalNode(middle_pair.first)];
+            pairsVec.reserve(middle_pair.second.size());
+            for (const auto& inner_pair : middle_pair.second) {
+                pairsVec.emplace_back(index->toExternalNode(inner_pair.first), inner_pair.second);
+            }
+        }
+    }
+    return ranking;
 }
 
 
@@ -142,7 +157,7 @@ std::unordered_map<int, std::unordered_map<int, std::unordered_map<int, std::vec
                     }
                 }
 
-                convertedData[outerKey][middleKey][innerKey] = ruleIds;
+                convertedData[outerKey][index->toExternalNode(middleKey)][index->toExternalNode(innerKey)] = ruleIds;
             }
         }
     }
@@ -33,6 +33,9 @@ public:
     std::unordered_map<int,std::unordered_map<int, std::unordered_map<int, std::vector<int>>>> getIdxRules(std::string headOrTail);
     std::unordered_map<std::string,std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::string>>>> getStrRules(std::string headOrTail);
 
+    // "stopped_queries" and "skipped_rules" of the last ranking with certified_stop
+    std::map<std::string, long long> getCertifiedStopStats();
+
     void setOptions(std::map<std::string, std::string> options);
     void setOptionsFrontend(std::map<std::string, std::string> options);
 private:
@@ -112,6 +112,7 @@ void RulesHandler::calcRulesPredictions(std::vector<std::string>& stringRules, s
         parsed_rules.push_back(std::move(rule));
     }
 
+    auto lock = dHandler->readLock();
     #pragma omp parallel num_threads(num_thr)
     {
         TripleStorage& data = dHandler->getData();
@@ -196,10 +197,11 @@ void RulesHandler::writeRulesPredictions(std::string& outputPath, bool flat, boo
                 setOfTriples.insert(triple_tuple); 
             }
         } 
+        // the set holds the ids of the api (see getIdxPredictions())
         for (auto triple : setOfTriples){
-            std::string head = strings ? index->getStringOfNodeId(std::get<0>(triple)) : std::to_string(std::get<0>(triple));
+            std::string head = strings ? index->getStringOfNodeId(index->toInternalNode(std::get<0>(triple))) : std::to_string(std::get<0>(triple));
             std::string rel = strings ? index->getStringOfRelId(std::get<1>(triple)) : std::to_string(std::get<1>(triple));
-            std::string tail = strings ? index->getStringOfNodeId(std::get<2>(triple)) : std::to_string(std::get<2>(triple));
+            std::string tail = strings ? index->getStringOfNodeId(index->toInternalNode(std::get<2>(triple))) : std::to_string(std::get<2>(triple));
             file << head << "\t" << rel << "\t" << tail << std::endl;
         }
     } else {
@@ -211,9 +213,9 @@ void RulesHandler::writeRulesPredictions(std::string& outputPath, bool flat, boo
             auto itr = this->predictions[idx].begin();
             for (; itr != this->predictions[idx].end(); itr++){
                 Triple triple = *itr;
-                std::string head = strings ? "\"" + index->getStringOfNodeId(triple[0]) + "\"" : std::to_string(triple[0]);
+                std::string head = strings ? "\"" + index->getStringOfNodeId(triple[0]) + "\"" : std::to_string(index->toExternalNode(triple[0]));
                 std::string rel = strings ? "\"" + index->getStringOfRelId(triple[1]) + "\"" : std::to_string(triple[1]);
-                std::string tail = strings ? "\"" + index->getStringOfNodeId(triple[2]) + "\"" : std::to_string(triple[2]);
+                std::string tail = strings ? "\"" + index->getStringOfNodeId(triple[2]) + "\"" : std::to_string(index->toExternalNode(triple[2]));
                 file << "[" << head << "," << rel << "," << tail << "]";
                 if (std::next(itr) != this->predictions[idx].end()) {
                     file << ",";
@@ -258,7 +260,10 @@ std::vector<std::vector<std::array<int, 3>>> RulesHandler::getIdxPredictions(){
 
     std::vector<std::vector<std::array<int, 3>>> out(predictions.size());
     for (int i=0; i<predictions.size(); i++){
-        out[i] = std::vector<std::array<int,3>>(predictions[i].begin(), predictions[i].end());
+        out[i].reserve(predictions[i].size());
+        for (auto& triple: predictions[i]){
+            out[i].push_back({index->toExternalNode(triple[0]), triple[1], index->toExternalNode(triple[2])});
+        }
     }
     return out;
 }
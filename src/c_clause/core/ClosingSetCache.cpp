@@ -0,0 +1,123 @@
+#include "ClosingSetCache.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+
+
+ClosingSetCache::ClosingSetCache(int numRules, int64_t budget, int numThreads){
+    this->budget = budget;
+    this->numThreads = std::max(1, numThreads);
+    numSlots = 2 * numRules;
+    slots.reset(new Slot[numSlots]);
+    active.reset(new ThreadEpoch[this->numThreads]);
+}
+
+ClosingSetCache::~ClosingSetCache(){
+    for (int i=0; i<numSlots; i++){
+        delete slots[i].cands.load();
+    }
+    for (auto& dropped : retired){
+        delete dropped.first;
+    }
+}
+
+
+void ClosingSetCache::beginQuery(int thread){
+    // seq_cst: a set that is dropped after this store is not freed before endQuery(), a set that was dropped
+    // before it cannot be loaded anymore (see evict())
+    active[thread].epoch.store(globalEpoch.load());
+}
+
+void ClosingSetCache::endQuery(int thread){
+    active[thread].epoch.store(0);
+}
+
+
+const std::vector<int>& ClosingSetCache::get(Rule* rule, TripleStorage& triples, bool dirIsTail, uint64_t tick, std::vector<int>& uncached){
+    int id = rule->getID();
+    // rules that are not in the storage are not cached
+    if (id < 0 || 2 * id + 1 >= numSlots){
+        rule->computeQueryIndependentCands(triples, dirIsTail, uncached);
+        return uncached;
+    }
+    Slot& slot = slots[2 * id + (int) dirIsTail];
+    const std::vector<int>* cands = slot.cands.load();
+    if (cands){
+        slot.lastUse.store(tick, std::memory_order_relaxed);
+        return *cands;
+    }
+
+    std::unique_ptr<std::vector<int>> computed(new std::vector<int>());
+    rule->computeQueryIndependentCands(triples, dirIsTail, *computed);
+    computed->shrink_to_fit();
+    int64_t setBytes = bytes(*computed);
+    if (budget >= 0 && setBytes > budget){
+        uncached.swap(*computed);
+        return uncached;
+    }
+    // another thread may have stored the same set in the meantime
+    const std::vector<int>* expected = nullptr;
+    if (!slot.cands.compare_exchange_strong(expected, computed.get())){
+        return *expected;
+    }
+    const std::vector<int>* stored = computed.release();
+    slot.lastUse.store(tick, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(evictMutex);
+        lru.emplace_back(tick, 2 * id + (int) dirIsTail);
+        std::push_heap(lru.begin(), lru.end(), std::greater<std::pair<uint64_t, int>>());
+        if (currSize.fetch_add(setBytes) + setBytes > budget && budget >= 0){
+            evict();
+        }
+    }
+    // the set may have been dropped right away but it is not freed before endQuery()
+    return *stored;
+}
+
+
+void ClosingSetCache::evict(){
+    auto later = std::greater<std::pair<uint64_t, int>>();
+    while (currSize.load() > budget / 4 * 3 && !lru.empty()){
+        std::pop_heap(lru.begin(), lru.end(), later);
+        std::pair<uint64_t, int> oldest = lru.back();
+        lru.pop_back();
+        Slot& slot = slots[oldest.second];
+        uint64_t lastUse = slot.lastUse.load(std::memory_order_relaxed);
+        if (lastUse > oldest.first){
+            // used since it was pushed, queue it again with its current time
+            lru.emplace_back(lastUse, oldest.second);
+            std::push_heap(lru.begin(), lru.end(), later);
+            continue;
+        }
+        // an entry of a set that was dropped and stored again may be found twice, then the slot is empty
+        const std::vector<int>* dropped = slot.cands.exchange(nullptr);
+        if (dropped){
+            currSize.fetch_sub(bytes(*dropped));
+            // queries that start from now on cannot load the set anymore
+            retired.emplace_back(dropped, globalEpoch.fetch_add(1));
+        }
+    }
+    reclaim();
+}
+
+
+void ClosingSetCache::reclaim(){
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (int t=0; t<numThreads; t++){
+        uint64_t epoch = active[t].epoch.load();
+        if (epoch != 0){
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    // a query that started in epoch e may have loaded the sets dropped in epochs >= e
+    auto freed = std::remove_if(retired.begin(), retired.end(), [oldest](const std::pair<const std::vector<int>*, uint64_t>& dropped){
+        if (dropped.second < oldest){
+            delete dropped.first;
+            return true;
+        }
+        return false;
+    });
+    retired.erase(freed, retired.end());
+}
@@ -0,0 +1,85 @@
+#ifndef CLOSINGSETCACHE_H
+#define CLOSINGSETCACHE_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "Rule.h"
+#include "TripleStorage.h"
+
+
+// the query independent candidates of the rules (Rule::computeQueryIndependentCands()) for one ranking
+// a set is computed by the first query that needs it and then shared by all threads, a lookup of a stored set
+// is one atomic load (no lock); only storing and dropping sets take the mutex
+// when the sets get larger than the budget the least recently used ones are dropped and computed again when needed
+// dropped sets are freed once no query that could still read them is running (every thread announces its queries)
+class ClosingSetCache {
+
+    public:
+        // budget in bytes, -1 for no limit, 0 turns off the cache; threads are numbered 0..numThreads-1
+        ClosingSetCache(int numRules, int64_t budget, int numThreads);
+        ~ClosingSetCache();
+        ClosingSetCache(const ClosingSetCache&) = delete;
+        ClosingSetCache& operator=(const ClosingSetCache&) = delete;
+
+        bool enabled() const {
+            return budget != 0;
+        }
+
+        // get() may only be called between beginQuery() and endQuery() of the calling thread
+        // the returned sets stay valid until endQuery()
+        void beginQuery(int thread);
+        void endQuery(int thread);
+
+        // the candidates of rule in direction dirIsTail, tick is increasing with the queries (used for the eviction)
+        // sets that are not stored (e.g. larger than the budget) are computed into uncached
+        const std::vector<int>& get(Rule* rule, TripleStorage& triples, bool dirIsTail, uint64_t tick, std::vector<int>& uncached);
+
+        // bytes of the stored sets
+        int64_t size() const {
+            return currSize.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Slot {
+            std::atomic<const std::vector<int>*> cands{nullptr};
+            std::atomic<uint64_t> lastUse{0};
+        };
+        // one slot per rule and direction
+        std::unique_ptr<Slot[]> slots;
+        int numSlots;
+        int64_t budget;
+        std::atomic<int64_t> currSize{0};
+
+        // epoch based reclamation of dropped sets
+        // active[t] is the epoch thread t saw when its current query started, 0 when it runs no query
+        // padded to 64 bytes such that the epochs of two threads are never on the same cache line
+        // (no alignas, over-aligned new needs C++17)
+        struct ThreadEpoch {
+            std::atomic<uint64_t> epoch{0};
+            char pad[64 - sizeof(std::atomic<uint64_t>)];
+        };
+        std::unique_ptr<ThreadEpoch[]> active;
+        int numThreads;
+        std::atomic<uint64_t> globalEpoch{1};
+
+        // guards everything below
+        std::mutex evictMutex;
+        // min-heap of (lastUse when pushed, slot) over the stored sets, entries are refreshed lazily when popped
+        std::vector<std::pair<uint64_t, int>> lru;
+        // dropped sets and the epoch in which they were dropped
+        std::vector<std::pair<const std::vector<int>*, uint64_t>> retired;
+
+        static int64_t bytes(const std::vector<int>& cands){
+            return sizeof(std::vector<int>) + cands.size() * sizeof(int);
+        }
+        // drops the least recently used sets until they take at most 3/4 of the budget, needs evictMutex
+        void evict();
+        // frees the dropped sets no running query can read anymore, needs evictMutex
+        void reclaim();
+};
+
+#endif // CLOSINGSETCACHE_H
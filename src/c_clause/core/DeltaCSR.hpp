@@ -0,0 +1,62 @@
+#ifndef DELTACSR_H
+#define DELTACSR_H
+
+#include "Types.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// triples that were added after the RelationalCSR was built (see TripleStorage::loadDelta())
+// a row is stored completely (the entries of the layers below and the new ones), sorted and deduplicated
+// such that a lookup is still a single span; only the rows, row lists and degrees that changed are stored
+struct DeltaCSR {
+    // row of (relation, direction, node)
+    std::unordered_map<uint64_t, std::vector<int>> rows;
+    // non-empty rows of (relation, direction), ascending
+    std::unordered_map<uint64_t, std::vector<int>> sources;
+    std::unordered_map<int, int> degrees;
+    // the new triples, they are merged into a fresh CSR on compaction
+    TripleSet triples;
+    // size of the index when the layer was frozen, the compacted CSR is built with it
+    int numNodes = 0;
+    int numRelations = 0;
+
+    static uint64_t rowKey(int relation, bool inverse, int node){
+        return ((uint64_t) relation << 33) | ((uint64_t) inverse << 32) | (uint32_t) node;
+    }
+
+    static uint64_t sourcesKey(int relation, bool inverse){
+        return ((uint64_t) relation << 1) | inverse;
+    }
+
+    bool getRow(int relation, bool inverse, int node, int*& begin, int& length){
+        auto it = rows.find(rowKey(relation, inverse, node));
+        if (it == rows.end()){
+            return false;
+        }
+        begin = it->second.data();
+        length = it->second.size();
+        return true;
+    }
+
+    bool getSources(int relation, bool inverse, int*& begin, int& length){
+        auto it = sources.find(sourcesKey(relation, inverse));
+        if (it == sources.end()){
+            return false;
+        }
+        begin = it->second.data();
+        length = it->second.size();
+        return true;
+    }
+
+    bool getDegree(int node, int& degree){
+        auto it = degrees.find(node);
+        if (it == degrees.end()){
+            return false;
+        }
+        degree = it->second;
+        return true;
+    }
+};
+
+#endif // DELTACSR_H
@@ -0,0 +1,63 @@
+#ifndef ENTITYCOLLECTOR_H
+#define ENTITYCOLLECTOR_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// the closing entities of a rule for one query (see Rule::searchCurrGroundings())
+// every thread reuses one collector, an entity is contained when its stamp equals the current epoch
+// the entities are kept once in the order they were found
+class EntityCollector {
+    private:
+        std::vector<uint32_t> stamps;
+        uint32_t epoch = 1;
+        std::vector<int> entities;
+
+    public:
+        // the collector of this thread, empty and large enough for numNodes entities
+        // it is valid until local() is called again on the thread
+        static EntityCollector& local(int numNodes){
+            static thread_local EntityCollector collector;
+            if (numNodes > (int) collector.stamps.size()){
+                collector.stamps.resize(numNodes, 0);
+            }
+            collector.clear();
+            return collector;
+        }
+
+        void insert(int entity){
+            if (stamps[entity] != epoch){
+                stamps[entity] = epoch;
+                entities.push_back(entity);
+            }
+        }
+
+        bool contains(int entity) const {
+            return stamps[entity] == epoch;
+        }
+
+        int size() const {
+            return entities.size();
+        }
+
+        std::vector<int>::const_iterator begin() const {
+            return entities.begin();
+        }
+
+        std::vector<int>::const_iterator end() const {
+            return entities.end();
+        }
+
+        void clear(){
+            entities.clear();
+            epoch++;
+            // wrapped around, old stamps could be taken for the new epoch
+            if (epoch == 0){
+                std::fill(stamps.begin(), stamps.end(), 0);
+                epoch = 1;
+            }
+        }
+};
+
+#endif //ENTITYCOLLECTOR_H
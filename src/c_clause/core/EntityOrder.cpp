@@ -0,0 +1,114 @@
+#include "EntityOrder.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+
+namespace {
+
+    // undirected adjacency of the union graph, without self loops; duplicates (from several relations) are kept
+    struct Adjacency {
+        std::vector<size_t> rowPtr;
+        std::vector<int> colInd;
+
+        Adjacency(int numNodes, const TripleSet& triples){
+            rowPtr.assign(numNodes + 1, 0);
+            for (const Triple& triple: triples){
+                if (triple[0] != triple[2]){
+                    rowPtr[1 + triple[0]] += 1;
+                    rowPtr[1 + triple[2]] += 1;
+                }
+            }
+            std::partial_sum(rowPtr.begin(), rowPtr.end(), rowPtr.begin());
+            colInd.resize(rowPtr[numNodes]);
+            std::vector<size_t> insertAt(rowPtr.begin(), rowPtr.end() - 1);
+            for (const Triple& triple: triples){
+                if (triple[0] != triple[2]){
+                    colInd[insertAt[triple[0]]++] = triple[2];
+                    colInd[insertAt[triple[2]]++] = triple[0];
+                }
+            }
+        }
+
+        int degree(int node) const {
+            return rowPtr[node+1] - rowPtr[node];
+        }
+    };
+
+    // entities sorted by degree, ties by id
+    std::vector<int> byDegree(const Adjacency& adj, int numNodes, bool descending){
+        std::vector<int> nodes(numNodes);
+        std::iota(nodes.begin(), nodes.end(), 0);
+        std::stable_sort(nodes.begin(), nodes.end(), [&adj, descending](int a, int b){
+            return descending ? adj.degree(a) > adj.degree(b) : adj.degree(a) < adj.degree(b);
+        });
+        return nodes;
+    }
+
+    // visits the components in the order of starts; neighbours in ascending degree if sortByDegree, otherwise as stored
+    std::vector<int> breadthFirst(const Adjacency& adj, int numNodes, const std::vector<int>& starts, bool sortByDegree){
+        std::vector<int> order;
+        order.reserve(numNodes);
+        std::vector<char> visited(numNodes, 0);
+        for (int start: starts){
+            if (visited[start]){
+                continue;
+            }
+            visited[start] = 1;
+            size_t head = order.size();
+            order.push_back(start);
+            while (head < order.size()){
+                int node = order[head++];
+                size_t firstNew = order.size();
+                for (size_t i=adj.rowPtr[node]; i<adj.rowPtr[node+1]; i++){
+                    int next = adj.colInd[i];
+                    if (!visited[next]){
+                        visited[next] = 1;
+                        order.push_back(next);
+                    }
+                }
+                if (sortByDegree){
+                    std::stable_sort(order.begin() + firstNew, order.end(), [&adj](int a, int b){
+                        return adj.degree(a) < adj.degree(b);
+                    });
+                }
+            }
+        }
+        return order;
+    }
+}
+
+
+namespace entityorder {
+
+    std::vector<int> compute(std::string method, int numNodes, const TripleSet& triples){
+        if (method == "none"){
+            return std::vector<int>();
+        } else if (method == "degree"){
+            return degreeOrder(numNodes, triples);
+        } else if (method == "bfs"){
+            return bfsOrder(numNodes, triples);
+        } else if (method == "rcm"){
+            return rcmOrder(numNodes, triples);
+        }
+        throw std::runtime_error("Entity order '" + method + "' is not known. Please choose from 'none', 'degree', 'bfs' or 'rcm'.");
+    }
+
+    std::vector<int> degreeOrder(int numNodes, const TripleSet& triples){
+        Adjacency adj(numNodes, triples);
+        return byDegree(adj, numNodes, true);
+    }
+
+    std::vector<int> bfsOrder(int numNodes, const TripleSet& triples){
+        Adjacency adj(numNodes, triples);
+        return breadthFirst(adj, numNodes, byDegree(adj, numNodes, true), false);
+    }
+
+    std::vector<int> rcmOrder(int numNodes, const TripleSet& triples){
+        Adjacency adj(numNodes, triples);
+        std::vector<int> order = breadthFirst(adj, numNodes, byDegree(adj, numNodes, false), true);
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef ENTITYORDER_H
+#define ENTITYORDER_H
+
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+// orders of the entities such that entities that are connected get close ids
+// the rows of neighbouring entities are then close in the CSRs, which helps the cache in the rule groundings
+// all orders are computed on the undirected union graph of all relations and are deterministic
+// an order is returned as order[newId] = oldId
+namespace entityorder {
+
+    // "none", "degree", "bfs" or "rcm", throws for other methods; empty for "none"
+    std::vector<int> compute(std::string method, int numNodes, const TripleSet& triples);
+
+    // descending degree, the frequent entities (touched by most groundings) are packed in the beginning
+    std::vector<int> degreeOrder(int numNodes, const TripleSet& triples);
+    // breadth first search, starting from the entity with the highest degree of every component
+    std::vector<int> bfsOrder(int numNodes, const TripleSet& triples);
+    // reverse Cuthill-McKee: breadth first search from a minimum degree entity, neighbours are visited
+    // in ascending degree, the order is reversed in the end; reduces the bandwidth of the adjacency matrix
+    std::vector<int> rcmOrder(int numNodes, const TripleSet& triples);
+}
+
+#endif // ENTITYORDER_H
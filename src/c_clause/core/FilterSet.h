@@ -0,0 +1,45 @@
+#ifndef FILTERSET_H
+#define FILTERSET_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// the entities that are filtered for one query, e.g., the rows of the train and filter CSR
+// every thread keeps one and fills it once per query, a lookup is a single compare
+// an entity is contained when its stamp equals the current epoch, clear() only starts a new epoch
+class FilterSet {
+    private:
+        std::vector<uint32_t> stamps;
+        uint32_t epoch = 1;
+
+    public:
+        FilterSet() {}
+        FilterSet(int numNodes): stamps(numNodes, 0) {}
+
+        // begin is a sorted row, the rows of several CSRs can be added for one query
+        void addSet(const int* begin, int length) {
+            if (length > 0 && begin[length-1] >= (int) stamps.size()){
+                // entities that were added after the set was created
+                stamps.resize(begin[length-1] + 1, 0);
+            }
+            for (int i=0; i<length; i++){
+                stamps[begin[i]] = epoch;
+            }
+        }
+
+        bool contains(int input) const {
+            return input < (int) stamps.size() && stamps[input] == epoch;
+        }
+
+        void clear(){
+            epoch++;
+            // wrapped around, old stamps could be taken for the new epoch
+            if (epoch == 0){
+                std::fill(stamps.begin(), stamps.end(), 0);
+                epoch = 1;
+            }
+        }
+};
+
+#endif //FILTERSET_H
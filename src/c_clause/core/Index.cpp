@@ -3,34 +3,26 @@
 #include <map>
 
 
-void Index::addNode(std::string& nodesstring) {
-	if (nodeToId.find(nodesstring) == nodeToId.end()) {
-		nodeToId[nodesstring] = maxNodeID;
-		idToNode[maxNodeID] = nodesstring;
-		maxNodeID++;
-	}
+int Index::addNode(std::string& nodesstring) {
+	return nodes.add(nodesstring.data(), nodesstring.size());
 }
 
-void Index::addRelation(std::string& relstring) {
-	if (relToId.find(relstring) == relToId.end()) {
-		relToId[relstring] = maxRelID;
-		idToRel[maxRelID] = relstring;
-		maxRelID++;
-	}
+int Index::addRelation(std::string& relstring) {
+	return relations.add(relstring.data(), relstring.size());
 }
 
 int Index::getNodeSize() {
-	return nodeToId.size();
+	return nodes.size();
 }
 
 int Index::getRelSize() {
-	return relToId.size();
+	return relations.size();
 }
 
 int Index::getIdOfNodestring(std::string& node) {
-	auto it = nodeToId.find(node);
-	if (it != nodeToId.end()) {
-		return it->second;
+	int id = nodes.find(node.data(), node.size());
+	if (id >= 0) {
+		return id;
 	}
 	else {
 			throw std::runtime_error(("Error: Node " + node + " not found in Trainingset").c_str());
@@ -38,9 +30,8 @@ int Index::getIdOfNodestring(std::string& node) {
 }
 
 std::string Index::getStringOfNodeId(int id) {
-	auto it = idToNode.find(id);
-	if (it != idToNode.end()) {
-		return it->second;
+	if (id >= 0 && id < nodes.size()) {
+		return nodes.get(id);
 	}
 	else {
 		std::cout << "Error: Idx " << id << " not found in idxToNode set";
@@ -49,9 +40,9 @@ std::string Index::getStringOfNodeId(int id) {
 }
 
 int Index::getIdOfRelationstring(std::string& relation) {
-	auto it = relToId.find(relation);
-	if (it != relToId.end()) {
-		return it->second;
+	int id = relations.find(relation.data(), relation.size());
+	if (id >= 0) {
+		return id;
 	}
 	else {
 		throw std::runtime_error(("Error: Relation " + relation + " not found in loaded data."));
@@ -59,9 +50,8 @@ int Index::getIdOfRelationstring(std::string& relation) {
 }
 
 std::string Index::getStringOfRelId(int id) {
-	auto it = idToRel.find(id);
-	if (it != idToRel.end()) {
-		return it->second;
+	if (id >= 0 && id < relations.size()) {
+		return relations.get(id);
 	}
 	else {
 		std::cout << "Error: Idx " << id << " not found in idxToRel set";
@@ -69,63 +59,154 @@ std::string Index::getStringOfRelId(int id) {
 	}
 }
 
+// the tables only grow, release what was reserved for growing once the index is complete
 void Index::rehash() {
-	nodeToId.rehash(nodeToId.size());
-	relToId.rehash(relToId.size());
-	idToNode.rehash(idToNode.size());
-	idToRel.rehash(idToRel.size());
+	nodes.shrink();
+	relations.shrink();
 }
 
-
-std::unordered_map<std::string, int>& Index::getNodeToIdx(){
-	return nodeToId;
+static std::unordered_map<std::string, int> toMap(StringDict& dict){
+	std::unordered_map<std::string, int> stringToId;
+	stringToId.reserve(dict.size());
+	for (int i=0; i<dict.size(); i++){
+		std::string str = dict.get(i);
+		stringToId[str] = dict.find(str.data(), str.size());
+	}
+	return stringToId;
 }
 
-std::unordered_map<std::string, int>& Index::getRelationToIdx(){
-	return relToId;
+std::unordered_map<std::string, int> Index::getNodeToIdx(){
+	std::unordered_map<std::string, int> stringToId = toMap(nodes);
+	if (numPermuted > 0){
+		for (auto& pair : stringToId){
+			pair.second = toExternalNode(pair.second);
+		}
+	}
+	return stringToId;
+}
 
+std::unordered_map<std::string, int> Index::getRelationToIdx(){
+	return toMap(relations);
 }
 
+// the arena cannot change strings in place, the dictionary is rebuilt with the same ids
+// new strings do not have to be unique (e.g. names of entities), the lookup of a new string
+// returns the id of the last replacement with that string
+static void substitute(StringDict& dict, std::map<std::string, std::string>& newStrings){
+	StringDict substituted;
+	for (int i=0; i<dict.size(); i++){
+		std::string str = dict.get(i);
+		auto it = newStrings.find(str);
+		if (it != newStrings.end()){
+			str = it->second;
+		}
+		substituted.push(str.data(), str.size());
+	}
+	for (const auto& pair : newStrings) {
+		int id = dict.find(pair.first.data(), pair.first.size());
+		if (id >= 0){
+			substituted.setLookup(pair.second.data(), pair.second.size(), id);
+		}
+	}
+	dict = std::move(substituted);
+	dict.shrink();
+}
 
 // exchange the strings of entitiess with the strings found in the keys of the map
 void Index::subsEntityStrings(std::map<std::string, std::string>& newStrings){
-	for (const auto& pair : newStrings) {
-		if (nodeToId.count(pair.first)) { 
-			int tempID = nodeToId[pair.first];
-			nodeToId.erase(pair.first); 
-			nodeToId[pair.second] = tempID;
-			idToNode[tempID] = pair.second;
-    	}
-	}
+	substitute(nodes, newStrings);
 }
 // exchange the strings of relations with the strings found in the keys of the map
 void Index::subsRelationStrings(std::map<std::string, std::string>& newStrings){
-	for (const auto& pair : newStrings) {
-		if (relToId.count(pair.first)) { 
-			int tempID = relToId[pair.first];
-			relToId.erase(pair.first); 
-			relToId[pair.second] = tempID;
-			idToRel[tempID] = pair.second;
-    	}
-	}
+	substitute(relations, newStrings);
 }
 
 void Index::setNodeIndex(std::vector<std::string>& newIdxToNode){
-	idToNode.clear();
-	nodeToId.clear();
-	maxNodeID = 0;
-
+	nodes.clear();
+	nodeToExternal.clear();
+	nodeToInternal.clear();
+	updateView();
 	for (int i=0; i<newIdxToNode.size(); i++){
 		addNode(newIdxToNode[i]);
 	}
 }
 
 void Index::setRelIndex(std::vector<std::string>& newIdxToRel){
-	idToRel.clear();
-	relToId.clear();
-	maxRelID = 0;
+	relations.clear();
 	for (int i=0; i<newIdxToRel.size(); i++){
 		addRelation(newIdxToRel[i]);
 	}
-	
-}
\ No newline at end of file
+
+}
+
+void Index::permuteNodes(const std::vector<int>& order){
+	if (order.size() != nodes.size()){
+		throw std::runtime_error("The entity order has to contain every entity once.");
+	}
+	StringDict permuted;
+	std::vector<int> toExternal(order.size());
+	for (int i=0; i<order.size(); i++){
+		std::string str = nodes.get(order[i]);
+		permuted.push(str.data(), str.size());
+		toExternal[i] = toExternalNode(order[i]);
+	}
+	// keep the lookup of non unique strings (see substitute)
+	for (int i=0; i<order.size(); i++){
+		std::string str = nodes.get(order[i]);
+		if (nodes.find(str.data(), str.size()) == order[i]){
+			permuted.setLookup(str.data(), str.size(), i);
+		}
+	}
+	nodes = std::move(permuted);
+	nodes.shrink();
+	nodeToExternal = std::move(toExternal);
+	nodeToInternal.assign(order.size(), -1);
+	for (int i=0; i<order.size(); i++){
+		nodeToInternal[nodeToExternal[i]] = i;
+	}
+	updateView();
+}
+
+int Index::toExternalNode(int id){
+	return (id >= 0 && id < numPermuted) ? toExternalView[id] : id;
+}
+
+int Index::toInternalNode(int id){
+	return (id >= 0 && id < numPermuted) ? toInternalView[id] : id;
+}
+
+void Index::updateView(){
+	toExternalView = nodeToExternal.data();
+	toInternalView = nodeToInternal.data();
+	numPermuted = nodeToExternal.size();
+}
+
+// the string tables (see StringDict::write()) and both directions of the entity order
+void Index::write(std::ostream& out){
+	nodes.write(out);
+	relations.write(out);
+	snapshot::writeArray(out, toExternalView, numPermuted);
+	snapshot::writeArray(out, toInternalView, numPermuted);
+}
+
+void Index::read(snapshot::Reader& reader, std::shared_ptr<util::MappedFile> file){
+	nodes.read(reader);
+	relations.read(reader);
+	int64_t numToExternal, numToInternal;
+	const int* toExternal = reader.readArray<int>(numToExternal);
+	const int* toInternal = reader.readArray<int>(numToInternal);
+	if ((numToExternal != 0 && numToExternal != nodes.size()) || numToInternal != numToExternal){
+		throw std::runtime_error("Snapshot file is corrupted, invalid entity order.");
+	}
+	for (int i=0; i<numToExternal; i++){
+		if (toExternal[i] < 0 || toExternal[i] >= numToExternal || toInternal[toExternal[i]] != i){
+			throw std::runtime_error("Snapshot file is corrupted, invalid entity order.");
+		}
+	}
+	nodeToExternal.clear();
+	nodeToInternal.clear();
+	toExternalView = toExternal;
+	toInternalView = toInternal;
+	numPermuted = numToExternal;
+	mappedFile = file;
+}
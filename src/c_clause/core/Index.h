@@ -9,11 +9,16 @@
 #include <map>
 #include <vector>
 
+#include "Snapshot.hpp"
+#include "StringDict.h"
+#include "Util.hpp"
+
 class Index {
 
 public:
-	void addNode(std::string& nodesstring);
-	void addRelation(std::string& relstring);
+	// both return the id of the string (also when it was already contained)
+	int addNode(std::string& nodesstring);
+	int addRelation(std::string& relstring);
 	int getNodeSize();
 	int getRelSize();
 	int getIdOfNodestring(std::string& node);
@@ -21,8 +26,9 @@ public:
 	int getIdOfRelationstring(std::string& relation);
 	std::string getStringOfRelId(int id);
 	void rehash();
-	std::unordered_map<std::string, int>& getNodeToIdx();
-	std::unordered_map<std::string, int>& getRelationToIdx();
+	// copies of the string -> id tables
+	std::unordered_map<std::string, int> getNodeToIdx();
+	std::unordered_map<std::string, int> getRelationToIdx();
 	// exchange the strings of entitiess with the strings found in the keys of the map
 	void subsEntityStrings(std::map<std::string, std::string>& newNames);
 	// exchange the strings of relations with the strings found in the keys of the map
@@ -31,15 +37,32 @@ public:
 	void setNodeIndex(std::vector<std::string>& idxToNode);
 	void setRelIndex(std::vector<std::string>& idxToRel);
 
+	// entities can have other ids in the backend (internal) than in the api (external), e.g., such that
+	// neighbouring entities are close in memory (see EntityOrder.h); all ids the user passes in or gets back are external
+	// order[newId] is the current internal id of the entity that gets newId
+	void permuteNodes(const std::vector<int>& order);
+	int toExternalNode(int id);
+	int toInternalNode(int id);
 
-private:
-	std::unordered_map<std::string, int> nodeToId;
-	std::unordered_map<std::string, int> relToId;
-	std::unordered_map<int, std::string> idToNode;
-	std::unordered_map<int, std::string> idToRel;
+	// string tables for data snapshots (see Snapshot.hpp)
+	void write(std::ostream& out);
+	// the tables of the mapped snapshot are used in place, file is kept alive by the index
+	void read(snapshot::Reader& reader, std::shared_ptr<util::MappedFile> file);
 
-	int maxNodeID = 0;
-	int maxRelID = 0;
+
+private:
+	StringDict nodes;
+	StringDict relations;
+	// internal -> external id and back, empty if both are the same; ids beyond are the same in both
+	// (entities that are added later get the next id in both)
+	std::vector<int> nodeToExternal;
+	std::vector<int> nodeToInternal;
+	// the vectors above or the arrays of a snapshot
+	const int* toExternalView = nullptr;
+	const int* toInternalView = nullptr;
+	int numPermuted = 0;
+	void updateView();
+	std::shared_ptr<util::MappedFile> mappedFile;
 };
 
 #endif // INDEX_H
\ No newline at end of file
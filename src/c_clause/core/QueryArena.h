@@ -0,0 +1,107 @@
+#ifndef QUERYARENA_H
+#define QUERYARENA_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+// transient allocations of one query (aggregation maps, copies of rule lists, ...) are taken from a per thread
+// monotonic arena, deallocation is a no-op and the memory is given back at once when the Scope of the task is closed
+// every loop over queries opens a Scope for each task such that the arena does not grow over the queries
+class QueryArena {
+
+    public:
+        static QueryArena& local(){
+            static thread_local QueryArena arena;
+            return arena;
+        }
+
+        void* alloc(size_t bytes, size_t align){
+            while (current < blocks.size() && padded(used, align) + bytes > blocks[current].size){
+                current++;
+                used = 0;
+            }
+            if (current == blocks.size()){
+                size_t size = bytes > MIN_BLOCK_SIZE ? bytes : MIN_BLOCK_SIZE;
+                blocks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+            }
+            used = padded(used, align);
+            void* buffer = blocks[current].data.get() + used;
+            used += bytes;
+            return buffer;
+        }
+
+        struct Mark {
+            size_t current;
+            size_t used;
+        };
+        Mark mark() const {
+            return {current, used};
+        }
+        void release(Mark mark){
+            current = mark.current;
+            used = mark.used;
+        }
+
+        class Scope {
+            public:
+                Scope(): arena(QueryArena::local()), begin(arena.mark()) {}
+                ~Scope(){
+                    arena.release(begin);
+                }
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+            private:
+                QueryArena& arena;
+                Mark begin;
+        };
+
+    private:
+        static const size_t MIN_BLOCK_SIZE = 1 << 18;
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+        static size_t padded(size_t offset, size_t align){
+            return (offset + align - 1) & ~(align - 1);
+        }
+        // blocks are never freed, they are reused by the next tasks of the thread
+        std::vector<Block> blocks;
+        size_t current = 0;
+        size_t used = 0;
+};
+
+// stateless allocator on the arena of the allocating thread
+// containers using it must not outlive the Scope they were filled in
+template<class T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    ArenaAllocator() {}
+    template<class U>
+    ArenaAllocator(const ArenaAllocator<U>&) {}
+
+    T* allocate(size_t n){
+        return static_cast<T*>(QueryArena::local().alloc(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T*, size_t) {}
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&){
+    return true;
+}
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&){
+    return false;
+}
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<class K, class V>
+using ArenaMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+#endif //QUERYARENA_H
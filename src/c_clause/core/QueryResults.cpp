@@ -1,7 +1,11 @@
 #include "QueryResults.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include "Rule.h"
+#include "QueryArena.h"
+
+const int QueryResults::CHUNK_SIZE;
 
 QueryResults::QueryResults(int addTopK, int discAtLeast){
     this->addTopK = addTopK;
@@ -22,11 +26,19 @@ void QueryResults::insertRule(int cand, Rule* rule){
     if (addTopK>candidateOrder.size()){
          currentRule = rule;
     }
-    auto it = candRules.find(cand);
-    bool newCand = (it==candRules.end());
+    int pos = findCand(cand);
+    bool newCand = (pos==-1);
     // new candidate, insert only when specified by !onlyUpdate
     if (newCand && !onlyUpdate ){
+        if (cand >= (int) slotStamps.size()){
+            slotStamps.resize(cand + 1, 0);
+            slots.resize(cand + 1);
+        }
+        slotStamps[cand] = epoch;
+        slots[cand] = candidateOrder.size();
+        pos = candidateOrder.size();
         candidateOrder.push_back(cand);
+        cands.push_back({-1, -1, 0, 0.0, 0, nullptr});
         // discrimination tracking
         if (!firstRule && discAtLeast>0){
             firstRule = rule;
@@ -40,33 +52,112 @@ void QueryResults::insertRule(int cand, Rule* rule){
 
     // update 
 
-    if (num_top_rules>0 && !newCand && it->second.size() >= num_top_rules){
+    if (num_top_rules>0 && !newCand && cands[pos].numRules >= num_top_rules){
         return;
     }
 
     // known cand: always update
     // new cand: -> only add and update when explicitly asked by !onlyUpdate
     if (!onlyUpdate || !newCand){
-        candRules[cand].push_back(rule);
+        Cand& data = cands[pos];
+        addRule(data, rule);
         // we added a new rule, update aggregation score
         if (performAggregation && aggregationFunction=="noisyor" ){
-                candScores[cand] += -std::log(1-rule->getConfidence());
+                data.score += -std::log(1-rule->getConfidence());
+        }
+        candRulesBuilt = false;
+        candScoresBuilt = false;
+    }
+}
+
+void QueryResults::addRule(Cand& data, Rule* rule){
+    int offset = data.numRules % CHUNK_SIZE;
+    if (offset==0){
+        int chunk = rulePool.size();
+        rulePool.push_back(RuleChunk());
+        rulePool[chunk].next = -1;
+        if (data.lastChunk==-1){
+            data.firstChunk = chunk;
+        }else{
+            rulePool[data.lastChunk].next = chunk;
         }
+        data.lastChunk = chunk;
     }
+    rulePool[data.lastChunk].rules[offset] = rule;
+    data.numRules += 1;
+    if (!data.bestRule || rule->getRank() < data.bestRule->getRank()){
+        data.bestRule = rule;
+    }
+    // splitmix64 finalizer of the pointer, otherwise aligned pointers share their low bits
+    uint64_t x = (uint64_t) reinterpret_cast<uintptr_t>(rule);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= (x >> 31);
+    data.ruleHash = data.ruleHash * 0x100000001b3ULL + x;
+}
+
+bool QueryResults::equalRules(const Cand& a, const Cand& b) const {
+    if (a.numRules!=b.numRules || a.ruleHash!=b.ruleHash){
+        return false;
+    }
+    int chunkA = a.firstChunk;
+    int chunkB = b.firstChunk;
+    for (int i=0; i<a.numRules; i+=CHUNK_SIZE){
+        int n = std::min(CHUNK_SIZE, a.numRules-i);
+        const RuleChunk& ca = rulePool[chunkA];
+        const RuleChunk& cb = rulePool[chunkB];
+        if (!std::equal(ca.rules, ca.rules+n, cb.rules)){
+            return false;
+        }
+        chunkA = ca.next;
+        chunkB = cb.next;
+    }
+    return true;
 }
 
 std::unordered_map<int,double>& QueryResults::getCandScores(){
+    if (!candScoresBuilt){
+        candScores.clear();
+        // only noisyor aggregates while inserting
+        if (performAggregation && aggregationFunction=="noisyor"){
+            candScores.reserve(candidateOrder.size());
+            for (int i=0; i<candidateOrder.size(); i++){
+                candScores[candidateOrder[i]] = cands[i].score;
+            }
+        }
+        candScoresBuilt = true;
+    }
     return candScores;
 }
 
+void QueryResults::getCandScores(std::vector<std::pair<int, double>>& candScoresOut){
+    candScoresOut.clear();
+    if (performAggregation && aggregationFunction=="noisyor"){
+        candScoresOut.reserve(candidateOrder.size());
+        for (int i=0; i<candidateOrder.size(); i++){
+            candScoresOut.emplace_back(candidateOrder[i], cands[i].score);
+        }
+    }
+}
+
 void QueryResults::clear(){
     candRules.clear();
+    candScores.clear();
+    candRulesBuilt = false;
+    candScoresBuilt = false;
     candidateOrder.clear();
+    cands.clear();
+    rulePool.clear();
+    epoch++;
+    // wrapped around, old stamps could be taken for the new epoch
+    if (epoch == 0){
+        std::fill(slotStamps.begin(), slotStamps.end(), 0);
+        epoch = 1;
+    }
     firstRule = nullptr;
     currentRule = nullptr;
     trackTo = 0;
     numDiscriminated = 0;
-    candScores.clear();
     numTopRulesFinished = 0;
 }
 
@@ -74,11 +165,35 @@ std::vector<int>& QueryResults::getCandsOrdered(){
     return candidateOrder;
 }
 
+QueryResults::CandRules QueryResults::getRulesAt(int pos) const {
+    return CandRules(rulePool.data(), cands[pos].firstChunk, cands[pos].numRules);
+}
+
+Rule* QueryResults::getBestRuleAt(int pos) const {
+    return cands[pos].bestRule;
+}
+
 std::vector<Rule*>& QueryResults::getRulesForCand(int cand){
-    return candRules[cand];
+    return getCandRules()[cand];
 }
 
 NodeToPredRules& QueryResults::getCandRules(){
+    if (!candRulesBuilt){
+        candRules.clear();
+        candRules.reserve(candidateOrder.size());
+        for (int i=0; i<candidateOrder.size(); i++){
+            const Cand& data = cands[i];
+            std::vector<Rule*>& candRuleVec = candRules[candidateOrder[i]];
+            candRuleVec.reserve(data.numRules);
+            int chunk = data.firstChunk;
+            for (int j=0; j<data.numRules; j+=CHUNK_SIZE){
+                const RuleChunk& c = rulePool[chunk];
+                candRuleVec.insert(candRuleVec.end(), c.rules, c.rules + std::min(CHUNK_SIZE, data.numRules-j));
+                chunk = c.next;
+            }
+        }
+        candRulesBuilt = true;
+    }
     return candRules;
 }
 
@@ -87,11 +202,7 @@ int QueryResults::size(){
 }
 
 bool QueryResults::contains(int cand){
-    if (candRules.find(cand)!=candRules.end()){
-        return true;
-    }else{
-        return false;
-    }
+    return findCand(cand)!=-1;
 }
 
 bool QueryResults::empty(){
@@ -108,19 +219,15 @@ bool QueryResults::checkDiscrimination(){
         if (numDiscriminated>=discAtLeast){
             return true;
         }
-        int lastCand = candidateOrder[i-1];
-        int currentCand = candidateOrder[i];
-        std::vector<Rule*>& rulesLast = candRules[lastCand];
-        std::vector<Rule*>& rulesCurrent = candRules[currentCand];
-        
-        if //rulesets are equal
-        (rulesLast.size() == rulesCurrent.size() && std::equal(rulesCurrent.begin(), rulesCurrent.end(), rulesLast.begin(), rulesLast.end()))
+        if //rulesets of the consecutive candidates are equal
+        (equalRules(cands[i-1], cands[i]))
         {
             return false;
         }else{
             numDiscriminated += 1;
         }
     }
+    return false;
 }
 
 bool QueryResults::checkNumTopRules(){
@@ -135,7 +242,7 @@ bool QueryResults::checkNumTopRules(){
 
     for (int i=numTopRulesFinished; i<addTopK; i++){
 
-        if(candRules[candidateOrder[i]].size()>=num_top_rules){
+        if(cands[i].numRules>=num_top_rules){
             numTopRulesFinished += 1;
         }else{
             return false;
@@ -148,6 +255,74 @@ bool QueryResults::checkNumTopRules(){
     return false;
 }
 
+bool QueryResults::checkCertifiedTopK(int k, double threshold){
+    int n = candidateOrder.size();
+    // when topk is reached the next rules can only update known candidates
+    bool newCands = !(addTopK>0 && n>=addTopK);
+    if (n==0 || (newCands && n<k)){
+        return false;
+    }
+    int top = std::min(k, n);
+
+    // the maxplus score lists, rules are inserted in the order of their confidences
+    ArenaVector<double> confs;
+    ArenaVector<int> begins(n+1);
+    for (int i=0; i<n; i++){
+        begins[i] = confs.size();
+        int chunk = cands[i].firstChunk;
+        for (int j=0; j<cands[i].numRules; j+=CHUNK_SIZE){
+            const RuleChunk& c = rulePool[chunk];
+            for (int l=0; l<std::min(CHUNK_SIZE, cands[i].numRules-j); l++){
+                confs.push_back(c.rules[l]->getConfidence());
+            }
+            chunk = c.next;
+        }
+    }
+    begins[n] = confs.size();
+
+    // lexicographic maxplus order, ties are never certified so their order does not matter
+    ArenaVector<int> order(n);
+    for (int i=0; i<n; i++){
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&confs, &begins](int a, int b){
+        return std::lexicographical_compare(
+            confs.begin() + begins[b], confs.begin() + begins[b+1],
+            confs.begin() + begins[a], confs.begin() + begins[a+1]
+        );
+    });
+
+    // a stays before b whatever the remaining rules add (b==-1 is a candidate that is not found yet)
+    auto staysBefore = [&confs, &begins, threshold](int a, int b){
+        int lenA = begins[a+1] - begins[a];
+        int lenB = b==-1 ? 0 : begins[b+1] - begins[b];
+        const double* scoresA = confs.data() + begins[a];
+        const double* scoresB = b==-1 ? nullptr : confs.data() + begins[b];
+        for (int i=0; i<std::min(lenA, lenB); i++){
+            if (scoresA[i]!=scoresB[i]){
+                return scoresA[i]>scoresB[i];
+            }
+        }
+        // b is a prefix of a, new scores of b are at most threshold
+        return lenA>lenB && scoresA[lenB]>threshold;
+    };
+
+    for (int i=0; i<top-1; i++){
+        if (!staysBefore(order[i], order[i+1])){
+            return false;
+        }
+    }
+    for (int i=top; i<n; i++){
+        if (!staysBefore(order[top-1], order[i])){
+            return false;
+        }
+    }
+    if (newCands && !staysBefore(order[top-1], -1)){
+        return false;
+    }
+    return true;
+}
+
 
 void QueryResults::setAggrFunc(std::string name){
     aggregationFunction = name;
@@ -6,6 +6,9 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
 
 
 
@@ -24,14 +27,27 @@ public:
     bool empty();
     //delete all data
     void clear();
+    // the maps are built from the candidate table on demand and stay valid until the next insertRule() or clear()
+    // they are copies for callers that keep the rules (e.g. collect_rules), aggregation reads getRulesAt()
     std::vector<Rule*>& getRulesForCand(int cand);
     NodeToPredRules& getCandRules();
     std::unordered_map<int, double>& getCandScores();
+    // the same as getCandScores() in insertion order without building the map
+    void getCandScores(std::vector<std::pair<int, double>>& candScoresOut);
     std::vector<int>& getCandsOrdered();
+    class CandRules;
+    // the rules of the candidate at position pos of getCandsOrdered() in insertion order, they are read from
+    // the rule pool without copying and stay valid until the next insertRule() or clear()
+    CandRules getRulesAt(int pos) const;
+    // the rule with the lowest rank (highest confidence) of the candidate at pos, without reading its chunks
+    Rule* getBestRuleAt(int pos) const;
     // checks if at least discAtLeast top candidates can be fully disciminated
     bool checkDiscrimination();
 
     bool checkNumTopRules();
+    // maxplus: true if the top k candidates and their order cannot change anymore when only rules
+    // with a confidence of at most threshold are applied from now on (see calculateQueryResults())
+    bool checkCertifiedTopK(int k, double threshold);
 
     void setAggrFunc(std::string name);
     void setNumTopRules(int num);
@@ -43,14 +59,48 @@ public:
 
 
 private:
-    // stores vector of rules (pointers) for every candidate
-    //typedef NodeToPredRules:  std::unordered_map<int, std::vector<Rule*>> NodeToPredRules;
-    NodeToPredRules candRules;
+    // rules of a candidate are stored in linked chunks of the rule pool
+    static const int CHUNK_SIZE = 4;
+    struct RuleChunk {
+        Rule* rules[CHUNK_SIZE];
+        int next;
+    };
+    // data of a candidate, at the position of the candidate in candidateOrder
+    struct Cand {
+        int firstChunk;
+        int lastChunk;
+        int numRules;
+        double score;
+        // rolling hash of the rule sequence, with numRules the rules of two candidates
+        // only have to be compared when the hashes collide
+        uint64_t ruleHash;
+        Rule* bestRule;
+    };
+
+    // slot table indexed by entity, slotStamps[cand]==epoch marks a candidate of the current query
+    // slots[cand] is then the position of cand in candidateOrder
+    std::vector<uint32_t> slotStamps;
+    std::vector<int> slots;
+    uint32_t epoch = 1;
     // tracks insertion order of candidates elements are candidate idx's
     std::vector<int> candidateOrder;
-
-    // aggregation scores
+    std::vector<Cand> cands;
+    // reset in O(1) with every query
+    std::vector<RuleChunk> rulePool;
+
+    // position of cand in candidateOrder or -1
+    int findCand(int cand) const {
+        return (cand < (int) slotStamps.size() && slotStamps[cand] == epoch) ? slots[cand] : -1;
+    }
+    void addRule(Cand& data, Rule* rule);
+    bool equalRules(const Cand& a, const Cand& b) const;
+
+    // filled from the table by the accessors
+    //typedef NodeToPredRules:  std::unordered_map<int, std::vector<Rule*>> NodeToPredRules;
+    NodeToPredRules candRules;
     std::unordered_map<int, double> candScores;
+    bool candRulesBuilt = false;
+    bool candScoresBuilt = false;
 
     //**options**
     // maximal number of candidates to add modifies data storing
@@ -77,6 +127,70 @@ private:
     Rule* firstRule = nullptr;
     Rule* currentRule = nullptr;
 
+public:
+    // forward iterator over the chunks of a candidate
+    class RuleIterator {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Rule* value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Rule* const* pointer;
+            typedef Rule* const& reference;
+
+            RuleIterator() {}
+            RuleIterator(const RuleChunk* pool, int chunk, int left): pool(pool), chunk(chunk), left(left) {}
+            reference operator*() const {
+                return pool[chunk].rules[offset];
+            }
+            RuleIterator& operator++(){
+                left--;
+                offset++;
+                if (offset==CHUNK_SIZE){
+                    chunk = pool[chunk].next;
+                    offset = 0;
+                }
+                return *this;
+            }
+            RuleIterator operator++(int){
+                RuleIterator it = *this;
+                ++(*this);
+                return it;
+            }
+            // iterators of one candidate only differ in the number of rules left
+            bool operator==(const RuleIterator& other) const {
+                return left == other.left;
+            }
+            bool operator!=(const RuleIterator& other) const {
+                return left != other.left;
+            }
+        private:
+            const RuleChunk* pool = nullptr;
+            int chunk = -1;
+            int offset = 0;
+            int left = 0;
+    };
+
+    class CandRules {
+        public:
+            CandRules(const RuleChunk* pool, int firstChunk, int numRules): pool(pool), firstChunk(firstChunk), numRules(numRules) {}
+            RuleIterator begin() const {
+                return RuleIterator(pool, firstChunk, numRules);
+            }
+            RuleIterator end() const {
+                return RuleIterator(pool, -1, 0);
+            }
+            size_t size() const {
+                return numRules;
+            }
+            bool empty() const {
+                return numRules == 0;
+            }
+        private:
+            const RuleChunk* pool;
+            int firstChunk;
+            int numRules;
+    };
+
    
 
 
@@ -1,79 +1,602 @@
 #include <numeric>
+#include <limits>
+#include <memory>
 #include "Types.h"
+#include "Snapshot.hpp"
+#include "RowCodec.hpp"
 #include <algorithm>
 
+// a CSR whose fraction of non-empty rows is at most this is stored hypersparse (DCSR)
+// its rowPtr would be mostly zeros, memory then only scales with the number of edges
+// and a row lookup is a binary search in the sorted non-empty row ids
+const double DCSR_MAX_DENSITY = 0.125;
+
+// Offset is the type of the positions in colInd, uint32_t unless a CSR can have more than 2^32 entries
+template<class Offset>
 struct CSR{
-    int *rowPtr;
+    // dense: the row of node is colInd[rowPtr[node]] to colInd[rowPtr[node+1]], rowOffsets is null
+    // hypersparse: rowPtr is null, the row of rows[i] is colInd[rowOffsets[i]] to colInd[rowOffsets[i+1]]
+    Offset *rowPtr;
+    Offset *rowOffsets;
     int *colInd;
+    // ids of the rows (nodes) that have at least one entry, ascending
+    int *rows;
+    int numRows;
+    // compressed (see RowCodec.hpp): rowPtr, rowOffsets and colInd are null, the encoded row of node starts at
+    // bytes[bytePtr[node]] (dense, empty if bytePtr[node]==bytePtr[node+1]) or of rows[i] at bytes[byteOffsets[i]]
+    int64_t *bytePtr;
+    int64_t *byteOffsets;
+    uint8_t *bytes;
+    int64_t numBytes;
 };
 
 
+// the CSRs of all relations in both directions (see RelationalCSRImpl)
+// ids are ints, the width of the offsets is chosen when the CSRs are built such that small graphs
+// keep 32 bit offsets (smaller and more cache friendly) and large graphs are not limited to 2^31 edges
 class RelationalCSR {
 
     public:
-        RelationalCSR(int numRelations, int numNodes, RelNodeToNodes& relHeadToTails, RelNodeToNodes& relTailToHeads) {
+        // builds the CSRs directly from an edge list without any intermediate hash structures
+        // the rows of both directions are sorted and duplicate triples are removed
+        // triples is consumed (cleared) after it has been bucketed by relation
+        // compressed rows need less memory but are decoded on every lookup (see RowCodec.hpp)
+        static std::unique_ptr<RelationalCSR> build(int numRelations, int numNodes, TripleSet& triples, bool compressed=false);
+        // uses the arrays of a mapped snapshot in place (see write()), they are read-only and not owned
+        static std::unique_ptr<RelationalCSR> read(int numRelations, int numNodes, snapshot::Reader& reader);
+
+        virtual ~RelationalCSR() {}
+
+        virtual void write(std::ostream& out) = 0;
+
+        // nodes and relations that were added to the index after the CSR was built have empty rows
+        // rows of a compressed CSR are decoded into the RowScratch of the thread, they are valid until the current scope is closed
+        virtual void getTforHREfficient(int head, int relation, int*& begin, int& length) = 0;
+        virtual void getHforTREfficient(int tail, int relation, int*& begin, int& length) = 0;
+        // all heads that have at least one tail for relation (ascending)
+        virtual void getHeads(int relation, int*& begin, int& length) = 0;
+        // all tails that have at least one head for relation (ascending)
+        virtual void getTails(int relation, int*& begin, int& length) = 0;
+        // number of triples the node is part of (as head or tail)
+        virtual int getDegree(int node) = 0;
+        virtual bool contains(int head, int relation, int tail) = 0;
+        virtual int getNumNodes() = 0;
+        virtual int getNumRelations() = 0;
+        // appends all stored triples to triples
+        virtual void getTriples(TripleSet& triples) = 0;
+        // bytes of the neighbour lists (colInd or the compressed rows)
+        virtual int64_t getNeighbourBytes() = 0;
+        // size of an offset in bytes (4 or 8)
+        virtual int getOffsetSize() = 0;
+
+        Nodes* getTforHR(int head, int relation){
+            // copying dynamic array to std::vector would be more efficient and would not require new allocation/creation of set...
+			// using std::vector is ~5times faster
+            Nodes * nodes = new Nodes();
+            RowScratch::Scope scope;
+            int* begin;
+            int length;
+            getTforHREfficient(head, relation, begin, length);
+            nodes->insert(begin, begin + length);
+            return nodes;
+        }
+
+        Nodes* getHforTR(int tail, int relation){
+            Nodes * nodes = new Nodes();
+            RowScratch::Scope scope;
+            int* begin;
+            int length;
+            getHforTREfficient(tail, relation, begin, length);
+            nodes->insert(begin, begin + length);
+            return nodes;
+        }
+};
+
+
+template<class Offset>
+class RelationalCSRImpl final : public RelationalCSR {
+
+    public:
+        RelationalCSRImpl(int numRelations, int numNodes, TripleSet& triples, bool compressed) {
             this->numNodes = numNodes;
             this->numRelations = numRelations;
-            csrs = new CSR*[numRelations*2];
+            csrs = new CSR<Offset>*[numRelations*2];
+
+            // counting sort of the (head, tail) pairs by relation
+            std::vector<size_t> relPtr(numRelations + 1, 0);
+            for (const Triple& triple: triples){
+                relPtr[1 + triple[1]] += 1;
+            }
+            std::partial_sum(relPtr.begin(), relPtr.end(), relPtr.begin());
+            std::vector<std::array<int,2>> pairs(triples.size());
+            std::vector<size_t> insertAt(relPtr.begin(), relPtr.end() - 1);
+            for (const Triple& triple: triples){
+                pairs[insertAt[triple[1]]++] = {triple[0], triple[2]};
+            }
+            TripleSet().swap(triples);
+
+            #pragma omp parallel for schedule(dynamic)
             for (int rel=0; rel < numRelations; rel++){
-                csrs[rel] = getCsr(relHeadToTails[rel]);
-                csrs[numRelations + rel] = getCsr(relTailToHeads[rel]);
+                csrs[rel] = getCsr(pairs.data() + relPtr[rel], relPtr[rel+1] - relPtr[rel]);
+                csrs[numRelations + rel] = getInverseCsr(csrs[rel]);
+            }
+            setDegrees();
+            if (compressed){
+                #pragma omp parallel for schedule(dynamic)
+                for (int i=0; i < numRelations*2; i++){
+                    compress(csrs[i]);
+                }
             }
         }
 
-        ~RelationalCSR(){
+        RelationalCSRImpl(int numRelations, int numNodes, snapshot::Reader& reader) {
+            this->numNodes = numNodes;
+            this->numRelations = numRelations;
+            this->ownsArrays = false;
+            csrs = new CSR<Offset>*[numRelations*2];
+            for (int i=0; i < numRelations*2; i++){
+                CSR<Offset> *csr = new CSR<Offset>();
+                int64_t numRowPtr, numRowOffsets, numColInd, numRows;
+                csr->rowPtr = const_cast<Offset*>(reader.readArray<Offset>(numRowPtr));
+                csr->rowOffsets = const_cast<Offset*>(reader.readArray<Offset>(numRowOffsets));
+                csr->colInd = const_cast<int*>(reader.readArray<int>(numColInd));
+                csr->rows = const_cast<int*>(reader.readArray<int>(numRows));
+                csr->numRows = numRows;
+                int64_t numBytePtr, numByteOffsets;
+                csr->bytePtr = const_cast<int64_t*>(reader.readArray<int64_t>(numBytePtr));
+                csr->byteOffsets = const_cast<int64_t*>(reader.readArray<int64_t>(numByteOffsets));
+                csr->bytes = const_cast<uint8_t*>(reader.readArray<uint8_t>(csr->numBytes));
+                if (csr->numBytes > 0){
+                    checkCount(numRowPtr + numRowOffsets + numColInd, 0);
+                    csr->rowPtr = nullptr;
+                    csr->rowOffsets = nullptr;
+                    csr->colInd = nullptr;
+                    if (numBytePtr > 0){
+                        checkCount(numBytePtr, 1 + numNodes);
+                        checkCount(numByteOffsets, 0);
+                        checkCount(csr->numBytes, csr->bytePtr[numNodes] + rowcodec::PADDING);
+                        csr->byteOffsets = nullptr;
+                    }else{
+                        checkCount(numByteOffsets, 1 + numRows);
+                        checkCount(csr->numBytes, csr->byteOffsets[numRows] + rowcodec::PADDING);
+                        csr->bytePtr = nullptr;
+                    }
+                }else if (numRowPtr > 0){
+                    checkCount(numRowPtr, 1 + numNodes);
+                    checkCount(numRowOffsets, 0);
+                    checkCount(numColInd, csr->rowPtr[numNodes]);
+                    csr->rowOffsets = nullptr;
+                }else{
+                    checkCount(numRowOffsets, 1 + numRows);
+                    checkCount(numColInd, csr->rowOffsets[numRows]);
+                    csr->rowPtr = nullptr;
+                }
+                if (csr->numBytes == 0){
+                    checkCount(numBytePtr + numByteOffsets, 0);
+                    csr->bytePtr = nullptr;
+                    csr->byteOffsets = nullptr;
+                    csr->bytes = nullptr;
+                }
+                csrs[i] = csr;
+            }
+            int64_t count;
+            degrees = const_cast<int*>(reader.readArray<int>(count));
+            checkCount(count, numNodes);
+        }
+
+        ~RelationalCSRImpl(){
             for (int rel=0; rel < this->numRelations*2; rel++){
-                delete csrs[rel]->colInd;
-                delete csrs[rel]->rowPtr;
+                if (ownsArrays){
+                    delete[] csrs[rel]->colInd;
+                    delete[] csrs[rel]->rowPtr;
+                    delete[] csrs[rel]->rowOffsets;
+                    delete[] csrs[rel]->rows;
+                    delete[] csrs[rel]->bytePtr;
+                    delete[] csrs[rel]->byteOffsets;
+                    delete[] csrs[rel]->bytes;
+                }
                 delete csrs[rel];
             }
-            delete csrs;
+            if (ownsArrays){
+                delete[] degrees;
+            }
+            delete[] csrs;
         }
 
-        Nodes* getTforHR(int head, int relation){
-            // copying dynamic array to std::vector would be more efficient and would not require new allocation/creation of set...
-			// using std::vector is ~5times faster
-            Nodes * nodes = new Nodes();
-            int* colInd = this->csrs[relation]->colInd;
-            int* rowPtr = this->csrs[relation]->rowPtr;
-            nodes->insert(&colInd[rowPtr[head]], &colInd[rowPtr[head+1]]);
-            return nodes;
+        // layout: the size of Offset, then per CSR: rowPtr, rowOffsets (one of both is empty), colInd, rows, bytePtr, byteOffsets, bytes
+        // either the first three or the compressed last three arrays are empty
+        void write(std::ostream& out) override {
+            snapshot::writeValue<int64_t>(out, sizeof(Offset));
+            for (int i=0; i < numRelations*2; i++){
+                CSR<Offset>* csr = csrs[i];
+                snapshot::writeArray(out, csr->rowPtr, csr->rowPtr ? 1 + numNodes : 0);
+                snapshot::writeArray(out, csr->rowOffsets, csr->rowOffsets ? 1 + csr->numRows : 0);
+                snapshot::writeArray(out, csr->colInd, csr->bytes ? 0 : getNnz(csr));
+                snapshot::writeArray(out, csr->rows, csr->numRows);
+                snapshot::writeArray(out, csr->bytePtr, csr->bytePtr ? 1 + numNodes : 0);
+                snapshot::writeArray(out, csr->byteOffsets, csr->byteOffsets ? 1 + csr->numRows : 0);
+                snapshot::writeArray(out, csr->bytes, csr->numBytes);
+            }
+            snapshot::writeArray(out, degrees, numNodes);
         }
 
-        Nodes* getHforTR(int tail, int relation){
-            return getTforHR(tail, relation*2);
+        void getTforHREfficient(int head, int relation, int*& begin, int& length) override {
+            if (relation < 0 || relation >= numRelations){
+                begin = nullptr;
+                length = 0;
+                return;
+            }
+            getRow(this->csrs[relation], head, begin, length);
+        }
+
+        void getHforTREfficient(int tail, int relation, int*& begin, int& length) override {
+            if (relation < 0 || relation >= numRelations){
+                begin = nullptr;
+                length = 0;
+                return;
+            }
+            getRow(this->csrs[relation + numRelations], tail, begin, length);
+        }
+
+        void getHeads(int relation, int*& begin, int& length) override {
+            if (relation < 0 || relation >= numRelations){
+                begin = nullptr;
+                length = 0;
+                return;
+            }
+            begin = this->csrs[relation]->rows;
+            length = this->csrs[relation]->numRows;
+        }
+
+        void getTails(int relation, int*& begin, int& length) override {
+            if (relation < 0 || relation >= numRelations){
+                begin = nullptr;
+                length = 0;
+                return;
+            }
+            begin = this->csrs[relation + numRelations]->rows;
+            length = this->csrs[relation + numRelations]->numRows;
+        }
+
+        int getDegree(int node) override {
+            return (node >= 0 && node < numNodes) ? degrees[node] : 0;
+        }
+
+        bool contains(int head, int relation, int tail) override {
+            if (relation >= 0 && relation < numRelations && csrs[relation]->bytes){
+                const uint8_t* row = getEncodedRow(csrs[relation], head);
+                return row && rowcodec::contains(row, tail);
+            }
+            int* begin;
+            int length;
+            getTforHREfficient(head, relation, begin, length);
+            return std::binary_search(begin, begin + length, tail);
+        }
+
+        int getNumNodes() override {
+            return numNodes;
+        }
+
+        int getNumRelations() override {
+            return numRelations;
+        }
+
+        void getTriples(TripleSet& triples) override {
+            std::vector<int> row;
+            for (int rel=0; rel < numRelations; rel++){
+                CSR<Offset>* csr = csrs[rel];
+                for (int i=0; i < csr->numRows; i++){
+                    int head = csr->rows[i];
+                    if (csr->bytes){
+                        const uint8_t* encoded = csr->bytes + (csr->bytePtr ? csr->bytePtr[head] : csr->byteOffsets[i]);
+                        row.resize(rowcodec::rowLength(encoded));
+                        rowcodec::decodeRow(encoded, row.data());
+                        for (int tail : row){
+                            triples.push_back({head, rel, tail});
+                        }
+                        continue;
+                    }
+                    for (Offset j=rowBegin(csr, i); j < rowEnd(csr, i); j++){
+                        triples.push_back({head, rel, csr->colInd[j]});
+                    }
+                }
+            }
         }
 
-        void getTforHREfficient(int head, int relation, int*& begin, int& length){
-            int* colInd = this->csrs[relation]->colInd;
-            int* rowPtr = this->csrs[relation]->rowPtr;
-            begin = &colInd[rowPtr[head]];
-            length = rowPtr[head+1] - rowPtr[head];
+        int64_t getNeighbourBytes() override {
+            int64_t numBytes = 0;
+            for (int i=0; i < numRelations*2; i++){
+                numBytes += csrs[i]->bytes ? csrs[i]->numBytes : getNnz(csrs[i]) * (int64_t) sizeof(int);
+            }
+            return numBytes;
         }
 
-        void getHforTREfficient(int tail, int relation, int*& begin, int& length){
-            getTforHREfficient(tail, relation+numRelations, begin, length);
+        int getOffsetSize() override {
+            return sizeof(Offset);
         }
+
     private:
         int numNodes;
         int numRelations;
-        CSR ** csrs;
+        CSR<Offset> ** csrs;
+        int* degrees;
+        // false if the arrays belong to a mapped snapshot
+        bool ownsArrays = true;
+
+        void checkCount(int64_t count, int64_t expected){
+            if (count != expected){
+                throw std::runtime_error("Snapshot file is corrupted, unexpected CSR size.");
+            }
+        }
+
+        void getRow(CSR<Offset>* csr, int node, int*& begin, int& length){
+            if (node < 0 || node >= numNodes){
+                begin = nullptr;
+                length = 0;
+                return;
+            }
+            if (csr->bytes){
+                const uint8_t* row = getEncodedRow(csr, node);
+                if (!row){
+                    begin = nullptr;
+                    length = 0;
+                    return;
+                }
+                length = rowcodec::rowLength(row);
+                begin = RowScratch::local().alloc(length);
+                rowcodec::decodeRow(row, begin);
+                return;
+            }
+            if (csr->rowPtr){
+                begin = &csr->colInd[csr->rowPtr[node]];
+                length = csr->rowPtr[node+1] - csr->rowPtr[node];
+                return;
+            }
+            int* row = std::lower_bound(csr->rows, csr->rows + csr->numRows, node);
+            if (row != csr->rows + csr->numRows && *row == node){
+                int i = row - csr->rows;
+                begin = &csr->colInd[csr->rowOffsets[i]];
+                length = csr->rowOffsets[i+1] - csr->rowOffsets[i];
+            }else{
+                begin = csr->colInd;
+                length = 0;
+            }
+        }
+
+        // null if the row is empty
+        const uint8_t* getEncodedRow(CSR<Offset>* csr, int node){
+            if (node < 0 || node >= numNodes){
+                return nullptr;
+            }
+            if (csr->bytePtr){
+                return csr->bytePtr[node] != csr->bytePtr[node+1] ? csr->bytes + csr->bytePtr[node] : nullptr;
+            }
+            int* row = std::lower_bound(csr->rows, csr->rows + csr->numRows, node);
+            if (row != csr->rows + csr->numRows && *row == node){
+                return csr->bytes + csr->byteOffsets[row - csr->rows];
+            }
+            return nullptr;
+        }
+
+        // replaces colInd by the encoded rows, keeps the layout (dense or hypersparse) of the csr
+        void compress(CSR<Offset>* csr){
+            std::vector<uint8_t> encoded;
+            int64_t* offsets;
+            if (csr->rowPtr){
+                offsets = csr->bytePtr = new int64_t[1 + numNodes];
+                for (int node=0; node < numNodes; node++){
+                    offsets[node] = encoded.size();
+                    if (csr->rowPtr[node+1] != csr->rowPtr[node]){
+                        rowcodec::encodeRow(csr->colInd + csr->rowPtr[node], csr->rowPtr[node+1] - csr->rowPtr[node], encoded);
+                    }
+                }
+                offsets[numNodes] = encoded.size();
+            }else{
+                offsets = csr->byteOffsets = new int64_t[1 + csr->numRows];
+                for (int i=0; i < csr->numRows; i++){
+                    offsets[i] = encoded.size();
+                    rowcodec::encodeRow(csr->colInd + csr->rowOffsets[i], csr->rowOffsets[i+1] - csr->rowOffsets[i], encoded);
+                }
+                offsets[csr->numRows] = encoded.size();
+            }
+            encoded.resize(encoded.size() + rowcodec::PADDING, 0);
+            csr->numBytes = encoded.size();
+            csr->bytes = new uint8_t[encoded.size()];
+            std::copy(encoded.begin(), encoded.end(), csr->bytes);
+            delete[] csr->rowPtr;
+            delete[] csr->rowOffsets;
+            delete[] csr->colInd;
+            csr->rowPtr = nullptr;
+            csr->rowOffsets = nullptr;
+            csr->colInd = nullptr;
+        }
+
+        bool isHypersparse(size_t numRows){
+            return numRows <= DCSR_MAX_DENSITY * numNodes;
+        }
+
+        // begin and end of the i-th non-empty row in colInd
+        Offset rowBegin(CSR<Offset>* csr, int i){
+            return csr->rowPtr ? csr->rowPtr[csr->rows[i]] : csr->rowOffsets[i];
+        }
+
+        Offset rowEnd(CSR<Offset>* csr, int i){
+            return csr->rowPtr ? csr->rowPtr[csr->rows[i] + 1] : csr->rowOffsets[i+1];
+        }
+
+        Offset getNnz(CSR<Offset>* csr){
+            return csr->rowPtr ? csr->rowPtr[numNodes] : csr->rowOffsets[csr->numRows];
+        }
 
-        CSR* getCsr(NodeToNodes& nodeToNodes){
-            CSR *csr = new CSR();
-            csr->rowPtr = new int[1 + this->numNodes]; // rowPtr[0] is always 0
+        // number of (deduplicated) triples an entity is part of, as head or tail
+        void setDegrees(){
+            degrees = new int[numNodes];
+            std::fill(degrees, degrees + numNodes, 0);
+            #pragma omp parallel for schedule(dynamic)
+            for (int i=0; i < numRelations*2; i++){
+                CSR<Offset>* csr = csrs[i];
+                for (int j=0; j < csr->numRows; j++){
+                    #pragma omp atomic
+                    degrees[csr->rows[j]] += rowEnd(csr, j) - rowBegin(csr, j);
+                }
+            }
+        }
+
+        // pairs are (source, target); rows are sorted and deduplicated
+        // pairs is reordered
+        CSR<Offset>* getCsr(std::array<int,2>* pairs, size_t numPairs){
+            // not more rows than pairs, sorting is cheaper than touching all nodes
+            if (isHypersparse(numPairs)){
+                std::sort(pairs, pairs + numPairs);
+                size_t numUnique = std::unique(pairs, pairs + numPairs) - pairs;
+                return getHypersparseCsr(pairs, numUnique);
+            }
+
+            CSR<Offset> *csr = new CSR<Offset>();
+            csr->rowOffsets = nullptr;
+            csr->rowPtr = new Offset[1 + this->numNodes]; // rowPtr[0] is always 0
             std::fill(csr->rowPtr, csr->rowPtr + (1 + numNodes), 0);
-            for (auto& itNodeToNodes: nodeToNodes) {
-                csr->rowPtr[1 + itNodeToNodes.first] += itNodeToNodes.second.size();
+            for (size_t i=0; i < numPairs; i++){
+                csr->rowPtr[1 + pairs[i][0]] += 1;
             }
-            int nnz = std::accumulate(csr->rowPtr, csr->rowPtr + 1 + numNodes, 0);
-            // csr->nnz = nnz;
             std::partial_sum(csr->rowPtr, csr->rowPtr + 1 + numNodes, csr->rowPtr);
 
-            csr->colInd = new int[nnz];
-            for (auto& itNodeToNodes: nodeToNodes) {
-		std::partial_sort_copy(itNodeToNodes.second.begin(), itNodeToNodes.second.end(), &csr->colInd[csr->rowPtr[itNodeToNodes.first]], &csr->colInd[csr->rowPtr[itNodeToNodes.first]] + itNodeToNodes.second.size());
+            int* colInd = new int[numPairs];
+            std::vector<Offset> insertAt(csr->rowPtr, csr->rowPtr + numNodes);
+            for (size_t i=0; i < numPairs; i++){
+                colInd[insertAt[pairs[i][0]]++] = pairs[i][1];
+            }
+
+            // sort and dedup the rows in place; rowPtr[node+1] is still the old end when node is processed
+            Offset nnz = 0;
+            int numRows = 0;
+            for (int node=0; node < numNodes; node++){
+                int* first = colInd + csr->rowPtr[node];
+                int* last = colInd + csr->rowPtr[node+1];
+                std::sort(first, last);
+                last = std::unique(first, last);
+                csr->rowPtr[node] = nnz;
+                if (first != colInd + nnz){
+                    std::copy(first, last, colInd + nnz);
+                }
+                nnz += last - first;
+                numRows += (last != first);
             }
+            csr->rowPtr[numNodes] = nnz;
+
+            if ((size_t) nnz < numPairs){
+                csr->colInd = new int[nnz];
+                std::copy(colInd, colInd + nnz, csr->colInd);
+                delete[] colInd;
+            } else {
+                csr->colInd = colInd;
+            }
+            setRows(csr, numRows);
             return csr;
         }
+
+        // transposes csr; scattering the sources in ascending order keeps the new rows sorted
+        CSR<Offset>* getInverseCsr(CSR<Offset>* csr){
+            Offset nnz = getNnz(csr);
+            if (isHypersparse(nnz)){
+                std::vector<std::array<int,2>> pairs;
+                pairs.reserve(nnz);
+                for (int i=0; i < csr->numRows; i++){
+                    for (Offset j=rowBegin(csr, i); j < rowEnd(csr, i); j++){
+                        pairs.push_back({csr->colInd[j], csr->rows[i]});
+                    }
+                }
+                std::sort(pairs.begin(), pairs.end());
+                return getHypersparseCsr(pairs.data(), pairs.size());
+            }
+
+            CSR<Offset> *inv = new CSR<Offset>();
+            inv->rowOffsets = nullptr;
+            inv->rowPtr = new Offset[1 + this->numNodes];
+            std::fill(inv->rowPtr, inv->rowPtr + (1 + numNodes), 0);
+            for (Offset i=0; i < nnz; i++){
+                inv->rowPtr[1 + csr->colInd[i]] += 1;
+            }
+            std::partial_sum(inv->rowPtr, inv->rowPtr + 1 + numNodes, inv->rowPtr);
+
+            inv->colInd = new int[nnz];
+            std::vector<Offset> insertAt(inv->rowPtr, inv->rowPtr + numNodes);
+            for (int i=0; i < csr->numRows; i++){
+                int source = csr->rows[i];
+                for (Offset j=rowBegin(csr, i); j < rowEnd(csr, i); j++){
+                    inv->colInd[insertAt[csr->colInd[j]]++] = source;
+                }
+            }
+            int numRows = 0;
+            for (int node=0; node < numNodes; node++){
+                numRows += (inv->rowPtr[node+1] != inv->rowPtr[node]);
+            }
+            setRows(inv, numRows);
+            return inv;
+        }
+
+        // pairs must be sorted and unique
+        CSR<Offset>* getHypersparseCsr(const std::array<int,2>* pairs, size_t numPairs){
+            CSR<Offset> *csr = new CSR<Offset>();
+            csr->rowPtr = nullptr;
+            int numRows = 0;
+            for (size_t i=0; i < numPairs; i++){
+                numRows += (i == 0 || pairs[i][0] != pairs[i-1][0]);
+            }
+            csr->numRows = numRows;
+            csr->rows = new int[numRows];
+            csr->rowOffsets = new Offset[numRows + 1];
+            csr->colInd = new int[numPairs];
+            int row = -1;
+            for (size_t i=0; i < numPairs; i++){
+                if (i == 0 || pairs[i][0] != pairs[i-1][0]){
+                    row += 1;
+                    csr->rows[row] = pairs[i][0];
+                    csr->rowOffsets[row] = i;
+                }
+                csr->colInd[i] = pairs[i][1];
+            }
+            csr->rowOffsets[numRows] = numPairs;
+            return csr;
+        }
+
+        // sets the non-empty rows of a dense csr, switches to the hypersparse layout if there are only few of them
+        void setRows(CSR<Offset>* csr, int numRows){
+            csr->numRows = numRows;
+            csr->rows = new int[numRows];
+            int i = 0;
+            for (int node=0; node < numNodes; node++){
+                if (csr->rowPtr[node+1] != csr->rowPtr[node]){
+                    csr->rows[i++] = node;
+                }
+            }
+            if (isHypersparse(numRows)){
+                csr->rowOffsets = new Offset[numRows + 1];
+                for (int j=0; j < numRows; j++){
+                    csr->rowOffsets[j] = csr->rowPtr[csr->rows[j]];
+                }
+                csr->rowOffsets[numRows] = csr->rowPtr[numNodes];
+                delete[] csr->rowPtr;
+                csr->rowPtr = nullptr;
+            }
+        }
 };
+
+
+// 32 bit offsets as long as no CSR can have more entries, a CSR has at most as many entries as there are triples
+inline std::unique_ptr<RelationalCSR> RelationalCSR::build(int numRelations, int numNodes, TripleSet& triples, bool compressed){
+    if (triples.size() <= std::numeric_limits<uint32_t>::max()){
+        return std::unique_ptr<RelationalCSR>(new RelationalCSRImpl<uint32_t>(numRelations, numNodes, triples, compressed));
+    }
+    return std::unique_ptr<RelationalCSR>(new RelationalCSRImpl<uint64_t>(numRelations, numNodes, triples, compressed));
+}
+
+inline std::unique_ptr<RelationalCSR> RelationalCSR::read(int numRelations, int numNodes, snapshot::Reader& reader){
+    int64_t offsetSize = reader.readValue<int64_t>();
+    if (offsetSize == sizeof(uint32_t)){
+        return std::unique_ptr<RelationalCSR>(new RelationalCSRImpl<uint32_t>(numRelations, numNodes, reader));
+    }else if (offsetSize == sizeof(uint64_t)){
+        return std::unique_ptr<RelationalCSR>(new RelationalCSRImpl<uint64_t>(numRelations, numNodes, reader));
+    }
+    throw std::runtime_error("Snapshot file is corrupted, unexpected CSR offset size.");
+}
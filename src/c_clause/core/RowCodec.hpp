@@ -0,0 +1,266 @@
+#ifndef ROWCODEC_H
+#define ROWCODEC_H
+
+// compression of the sorted rows of a CSR (see RelationalCSRImpl::compress())
+// the gaps between neighbouring entries are stored with StreamVByte: 2 bit per value in a control byte
+// give the number of bytes (1-4) of the value, the values follow as little endian bytes
+// with SSSE3 four values are decoded by one shuffle (when built with -march=native as in setup.py)
+//
+// layout of a row: [varint n] [skip table] [blocks]
+// the values are split in blocks of BLOCK_SIZE, the skip table is only written for rows with more than one block
+// it holds for every block after the first {uint32 last value of the block before, uint32 byte offset of the block}
+// such that a membership check only decodes one block
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+
+// rows of compressed CSRs are decoded into a per thread stack of buffers
+// a decoded row is valid until the innermost Scope that was open when it was decoded is closed
+// every function that looks up rows opens a Scope such that the buffers do not grow over a query
+class RowScratch {
+
+    public:
+        static RowScratch& local(){
+            static thread_local RowScratch scratch;
+            return scratch;
+        }
+
+        int* alloc(size_t n){
+            while (current < blocks.size() && used + n > blocks[current].size){
+                current++;
+                used = 0;
+            }
+            if (current == blocks.size()){
+                size_t size = n > MIN_BLOCK_SIZE ? n : MIN_BLOCK_SIZE;
+                blocks.push_back({std::unique_ptr<int[]>(new int[size]), size});
+            }
+            int* buffer = blocks[current].data.get() + used;
+            used += n;
+            return buffer;
+        }
+
+        // for code that cannot nest Scopes, e.g., an iterative DFS releases the rows of every level itself
+        struct Mark {
+            size_t current;
+            size_t used;
+        };
+        Mark mark() const {
+            return {current, used};
+        }
+        void release(Mark mark){
+            current = mark.current;
+            used = mark.used;
+        }
+
+        class Scope {
+            public:
+                Scope(): scratch(RowScratch::local()), begin(scratch.mark()) {}
+                ~Scope(){
+                    scratch.release(begin);
+                }
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+            private:
+                RowScratch& scratch;
+                Mark begin;
+        };
+
+    private:
+        static const size_t MIN_BLOCK_SIZE = 1 << 16;
+        struct Block {
+            std::unique_ptr<int[]> data;
+            size_t size;
+        };
+        // blocks are never freed, the pointers of decoded rows stay valid when a new block is added
+        std::vector<Block> blocks;
+        size_t current = 0;
+        size_t used = 0;
+};
+
+
+namespace rowcodec {
+
+    const int BLOCK_SIZE = 128;
+    // decoding with SSSE3 loads 16 bytes at once, the byte array of a CSR is padded with it
+    const int PADDING = 16;
+
+    inline void writeVarint(uint32_t value, std::vector<uint8_t>& out){
+        while (value >= 128){
+            out.push_back((value & 127) | 128);
+            value >>= 7;
+        }
+        out.push_back(value);
+    }
+
+    inline uint32_t readVarint(const uint8_t*& in){
+        uint32_t value = 0;
+        int shift = 0;
+        while (*in & 128){
+            value |= (uint32_t) (*in++ & 127) << shift;
+            shift += 7;
+        }
+        value |= (uint32_t) (*in++) << shift;
+        return value;
+    }
+
+    inline uint32_t readUint32(const uint8_t* in){
+        uint32_t value;
+        std::memcpy(&value, in, 4);
+        return value;
+    }
+
+    inline void writeUint32(uint32_t value, uint8_t* out){
+        std::memcpy(out, &value, 4);
+    }
+
+    // the gaps of values (ascending, > base) as StreamVByte
+    inline void encodeBlock(const int* values, int n, uint32_t base, std::vector<uint8_t>& out){
+        size_t control = out.size();
+        out.resize(out.size() + (n + 3) / 4, 0);
+        uint32_t prev = base;
+        for (int i=0; i<n; i++){
+            uint32_t gap = (uint32_t) values[i] - prev;
+            prev = values[i];
+            int numBytes = gap < (1u << 8) ? 1 : gap < (1u << 16) ? 2 : gap < (1u << 24) ? 3 : 4;
+            out[control + i/4] |= (numBytes - 1) << (2 * (i % 4));
+            for (int b=0; b<numBytes; b++){
+                out.push_back((gap >> (8 * b)) & 255);
+            }
+        }
+    }
+
+    struct Tables {
+        // for every control byte: the shuffle mask that spreads the bytes of 4 values to 4 ints and their total length
+        uint8_t shuffle[256][16];
+        uint8_t length[256];
+
+        Tables(){
+            for (int control=0; control<256; control++){
+                int pos = 0;
+                for (int i=0; i<4; i++){
+                    int numBytes = ((control >> (2 * i)) & 3) + 1;
+                    for (int b=0; b<4; b++){
+                        shuffle[control][4*i + b] = b < numBytes ? pos + b : 0xFF;
+                    }
+                    pos += numBytes;
+                }
+                length[control] = pos;
+            }
+        }
+    };
+
+    inline const Tables& tables(){
+        static const Tables t;
+        return t;
+    }
+
+    // decodes a block of n values into out, returns the end of the block
+    inline const uint8_t* decodeBlock(const uint8_t* in, int n, uint32_t base, int* out){
+        const uint8_t* control = in;
+        const uint8_t* data = in + (n + 3) / 4;
+        uint32_t prev = base;
+        int i = 0;
+#ifdef __SSSE3__
+        const Tables& t = tables();
+        __m128i prevVec = _mm_set1_epi32(prev);
+        for (; i + 4 <= n; i += 4){
+            uint8_t c = control[i/4];
+            __m128i gaps = _mm_shuffle_epi8(
+                _mm_loadu_si128((const __m128i*) data), _mm_loadu_si128((const __m128i*) t.shuffle[c])
+            );
+            // prefix sum of the 4 gaps
+            gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+            gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+            __m128i values = _mm_add_epi32(gaps, prevVec);
+            _mm_storeu_si128((__m128i*) (out + i), values);
+            prevVec = _mm_shuffle_epi32(values, 0xFF);
+            data += t.length[c];
+        }
+        prev = _mm_cvtsi128_si32(prevVec);
+#endif
+        for (; i<n; i++){
+            int numBytes = ((control[i/4] >> (2 * (i % 4))) & 3) + 1;
+            uint32_t gap = 0;
+            for (int b=0; b<numBytes; b++){
+                gap |= (uint32_t) data[b] << (8 * b);
+            }
+            data += numBytes;
+            prev += gap;
+            out[i] = prev;
+        }
+        return data;
+    }
+
+    // appends the compressed row of the sorted and unique values
+    inline void encodeRow(const int* values, int n, std::vector<uint8_t>& out){
+        writeVarint(n, out);
+        int numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        size_t skipTable = out.size();
+        if (numBlocks > 1){
+            out.resize(out.size() + 8 * (numBlocks - 1));
+        }
+        size_t blocksBegin = out.size();
+        for (int b=0; b<numBlocks; b++){
+            uint32_t base = b == 0 ? 0 : values[b * BLOCK_SIZE - 1];
+            if (b > 0){
+                writeUint32(base, &out[skipTable + 8 * (b-1)]);
+                writeUint32(out.size() - blocksBegin, &out[skipTable + 8 * (b-1) + 4]);
+            }
+            encodeBlock(values + b * BLOCK_SIZE, std::min(BLOCK_SIZE, n - b * BLOCK_SIZE), base, out);
+        }
+    }
+
+    inline int rowLength(const uint8_t* row){
+        return readVarint(row);
+    }
+
+    // out needs space for rowLength(row) values
+    inline void decodeRow(const uint8_t* row, int* out){
+        int n = readVarint(row);
+        int numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (numBlocks > 1){
+            row += 8 * (numBlocks - 1);
+        }
+        uint32_t base = 0;
+        for (int b=0; b<numBlocks; b++){
+            int size = std::min(BLOCK_SIZE, n - b * BLOCK_SIZE);
+            row = decodeBlock(row, size, base, out + b * BLOCK_SIZE);
+            base = out[b * BLOCK_SIZE + size - 1];
+        }
+    }
+
+    // binary search in the skip table, only the block that can hold value is decoded
+    inline bool contains(const uint8_t* row, int value){
+        int n = readVarint(row);
+        int numBlocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint8_t* blocks = row + (numBlocks > 1 ? 8 * (numBlocks - 1) : 0);
+        // the first block whose base is >= value, value can only be in the block before
+        int lo = 0;
+        int hi = numBlocks - 1;
+        while (lo < hi){
+            int mid = (lo + hi) / 2;
+            if (readUint32(row + 8 * mid) < (uint32_t) value){
+                lo = mid + 1;
+            }else{
+                hi = mid;
+            }
+        }
+        // lo blocks (after the first) have a base < value
+        int block = lo;
+        uint32_t base = block == 0 ? 0 : readUint32(row + 8 * (block-1));
+        const uint8_t* in = block == 0 ? blocks : blocks + readUint32(row + 8 * (block-1) + 4);
+        int size = std::min(BLOCK_SIZE, n - block * BLOCK_SIZE);
+        int decoded[BLOCK_SIZE];
+        decodeBlock(in, size, base, decoded);
+        return std::binary_search(decoded, decoded + size, value);
+    }
+}
+
+#endif // ROWCODEC_H
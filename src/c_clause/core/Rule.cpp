@@ -36,11 +36,15 @@ double Rule::getConfidence(bool exact){
     if (exact){
         return confWeight * ((double) cpredicted/((double) predicted + (double)numUnseen)); 
     }else{
-        return confWeight *((double) sampledCpredicted/((double) sampledPredicted + (double)numUnseen)); 
+        return confidence;
     }
     
 }
 
+void Rule::updateConfidence(){
+    confidence = confWeight *((double) sampledCpredicted/((double) sampledPredicted + (double)numUnseen));
+}
+
 int Rule::getBranchingFactor(){
     return branchingFactor;
 }
@@ -57,6 +61,7 @@ void Rule::setStats(int _predicted, int _cpredicted, bool exact){
     }else{
         sampledCpredicted = _cpredicted;
         sampledPredicted = _predicted;
+        updateConfidence();
     }
 }
 
@@ -105,10 +110,23 @@ std::vector<bool>& Rule::getDirections() {
     return directions;
 }
 
-bool Rule::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  ManySet filterSet){
+bool Rule::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  const FilterSet& filterSet){
     throw std::runtime_error("Not implemented yet.");
 }
-bool Rule::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults,  ManySet filterSet){
+bool Rule::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults,  const FilterSet& filterSet){
+    throw std::runtime_error("Not implemented yet.");
+}
+
+void Rule::buildBodyIndex(TripleStorage& triples){
+}
+
+bool Rule::usesQueryIndependentCands(int source, bool dirIsTail){
+    return false;
+}
+void Rule::computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands){
+    throw std::runtime_error("Not implemented yet.");
+}
+bool Rule::predictQueryWithCands(int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail){
     throw std::runtime_error("Not implemented yet.");
 }
 
@@ -122,10 +140,12 @@ void Rule::setPredictTail(bool ind){
 
 void Rule::setConfWeight(double weight){
     confWeight = weight;
+    updateConfidence();
 }
 
 void Rule::setNumUnseen(int val){
     numUnseen = val;
+    updateConfidence();
 }
 
 bool Rule::predictTriple(int tail, int head, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings)
@@ -134,77 +154,227 @@ bool Rule::predictTriple(int tail, int head, TripleStorage& triples, QueryResult
 }
 
 
+namespace {
+    // searchCurrGroundings() for a body of LAST atoms, the direction of atom i is bit i-1 of DIRS
+    // every atom is its own instantiation, the loops are unrolled and the directions are constants
+    template<int ATOM, int LAST, unsigned DIRS>
+    inline void searchAtom(
+        int entity, Substitutions& substitutions, TripleStorage& triples, EntityCollector& closingEntities,
+        const int* rels, int maxBranching, RowScratch& scratch
+    ){
+        RowScratch::Mark mark = scratch.mark();
+        int* row;
+        int length;
+        (DIRS >> (ATOM-1)) & 1u ? triples.getTforHR(entity, rels[ATOM], row, length) : triples.getHforTR(entity, rels[ATOM], row, length);
+        if (ATOM == LAST){
+            for (int i=0; i<length; i++){
+                // respect object identity constraint
+                if (!substitutions.contains(row[i])){
+                    closingEntities.insert(row[i]);
+                }
+            }
+        }else if (maxBranching<=0 || length<=maxBranching){
+            for (int i=0; i<length; i++){
+                int ent = row[i];
+                if (substitutions.contains(ent)){
+                    continue;
+                }
+                substitutions.push(ent);
+                // the last atom instantiates itself here, it never gets to this branch
+                searchAtom<(ATOM < LAST ? ATOM+1 : LAST), LAST, DIRS>(ent, substitutions, triples, closingEntities, rels, maxBranching, scratch);
+                substitutions.pop();
+            }
+        }
+        scratch.release(mark);
+    }
+
+    template<int LAST, unsigned DIRS>
+    void searchBody(
+        int startEntity, Substitutions& substitutions, TripleStorage& triples, EntityCollector& closingEntities,
+        const int* rels, int maxBranching
+    ){
+        searchAtom<1, LAST, DIRS>(startEntity, substitutions, triples, closingEntities, rels, maxBranching, RowScratch::local());
+    }
+
+    typedef void (*SearchKernel)(int, Substitutions&, TripleStorage&, EntityCollector&, const int*, int);
+
+    // kernels[length][directions], bodies up to this length are searched with a kernel
+    const int MAX_KERNEL_LENGTH = 3;
+    const SearchKernel kernels[MAX_KERNEL_LENGTH+1][1 << MAX_KERNEL_LENGTH] = {
+        {},
+        {&searchBody<1, 0>, &searchBody<1, 1>},
+        {&searchBody<2, 0>, &searchBody<2, 1>, &searchBody<2, 2>, &searchBody<2, 3>},
+        {
+            &searchBody<3, 0>, &searchBody<3, 1>, &searchBody<3, 2>, &searchBody<3, 3>,
+            &searchBody<3, 4>, &searchBody<3, 5>, &searchBody<3, 6>, &searchBody<3, 7>
+        },
+    };
+}
+
+
+void Rule::searchCurrGroundings(
+		int startEntity, Substitutions& substitutions, TripleStorage& triples,
+		EntityCollector& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs, int maxBranching
+)
+{
+    int last = rels.size() - 1;
+    // short bodies (almost all rules) have a specialized kernel
+    if (last >= 1 && last <= MAX_KERNEL_LENGTH){
+        unsigned pattern = 0;
+        for (int i=0; i<last; i++){
+            pattern |= (unsigned) dirs[i] << i;
+        }
+        kernels[last][pattern](startEntity, substitutions, triples, closingEntities, rels.data(), maxBranching);
+        return;
+    }
+    // longer bodies are searched iteratively
+    // per atom: the entity it starts from, its row and the next position in the row
+    // decoded rows are released when the DFS leaves the atom
+    int entities[Substitutions::MAX_BODY_LENGTH + 1];
+    int* rows[Substitutions::MAX_BODY_LENGTH + 1];
+    int lengths[Substitutions::MAX_BODY_LENGTH + 1];
+    int positions[Substitutions::MAX_BODY_LENGTH + 1];
+    RowScratch::Mark marks[Substitutions::MAX_BODY_LENGTH + 1];
+    RowScratch& scratch = RowScratch::local();
+
+    int atom = 1;
+    entities[atom] = startEntity;
+    bool enter = true;
+    while (atom > 0){
+        if (enter){
+            marks[atom] = scratch.mark();
+            int currRel = rels[atom];
+            dirs[atom-1] ? triples.getTforHR(entities[atom], currRel, rows[atom], lengths[atom]) : triples.getHforTR(entities[atom], currRel, rows[atom], lengths[atom]);
+            positions[atom] = 0;
+            enter = false;
+            if (atom == last){
+                for (int i=0; i<lengths[atom]; i++){
+                    int ent = rows[atom][i];
+                    // respect object identity constraint, stop if violated
+                    if (!substitutions.contains(ent)){
+                        closingEntities.insert(ent);
+                    }
+                }
+                lengths[atom] = 0;
+            }else if (maxBranching>0 && lengths[atom]>maxBranching){
+                lengths[atom] = 0;
+            }
+        }
+        // next unbound entity of the atom
+        int* row = rows[atom];
+        int& pos = positions[atom];
+        while (pos < lengths[atom] && substitutions.contains(row[pos])){
+            pos++;
+        }
+        if (pos < lengths[atom]){
+            int ent = row[pos++];
+            substitutions.push(ent);
+            atom++;
+            entities[atom] = ent;
+            enter = true;
+        }else{
+            scratch.release(marks[atom]);
+            atom--;
+            // the entity that led to the atom that is left
+            if (atom > 0){
+                substitutions.pop();
+            }
+        }
+    }
+}
+
+
 void Rule::searchCurrTargetGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
+		int startEntity, Substitutions& substitutions, TripleStorage& triples,
 		int targetEntity, std::vector<int>& rels, std::vector<bool>& dirs, std::vector<Triple>& currentGroundings,
 		RuleGroundings* groundings, bool& reachedTarget,  bool invertGrounding
 )
 {
-    int currRel = rels[currAtomIdx];
-    int* begin;
-    int length;
-
     if (reachedTarget && !groundings){
         return;
     }
-    dirs[currAtomIdx-1] ? triples.getTforHR(currEntity, currRel, begin, length) : triples.getHforTR(currEntity, currRel, begin, length);
-    if (currAtomIdx == rels.size()-1){
-        // next entities
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            // IO and target checking
-            if (substitutions.find(ent)==substitutions.end() && targetEntity==ent){
-                reachedTarget = true;
-                
-                // we only track the groundings if groundings is given
-                if (groundings){
-                    Triple triple;
-                    if (dirs[currAtomIdx-1]){
-                        triple = {currEntity, currRel, ent};
-                    }else{
-                        triple = {ent, currRel, currEntity};
-                    }
-                    currentGroundings.push_back(triple);
-                    if (!invertGrounding){
-                        (*groundings)[this].push_back(currentGroundings);
-                    }else{
-                        std::vector<Triple> reverseGr = currentGroundings;
-                        std::reverse(reverseGr.begin(), reverseGr.end());
-                        (*groundings)[this].push_back(reverseGr);
+    int last = rels.size() - 1;
+    // same iteration as in searchCurrGroundings()
+    int entities[Substitutions::MAX_BODY_LENGTH + 1];
+    int* rows[Substitutions::MAX_BODY_LENGTH + 1];
+    int lengths[Substitutions::MAX_BODY_LENGTH + 1];
+    int positions[Substitutions::MAX_BODY_LENGTH + 1];
+    RowScratch::Mark marks[Substitutions::MAX_BODY_LENGTH + 1];
+    RowScratch& scratch = RowScratch::local();
+    // releases the rows on the early return
+    RowScratch::Scope scope;
+
+    int atom = 1;
+    entities[atom] = startEntity;
+    bool enter = true;
+    while (atom > 0){
+        int currRel = rels[atom];
+        int currEntity = entities[atom];
+        if (enter){
+            marks[atom] = scratch.mark();
+            dirs[atom-1] ? triples.getTforHR(currEntity, currRel, rows[atom], lengths[atom]) : triples.getHforTR(currEntity, currRel, rows[atom], lengths[atom]);
+            positions[atom] = 0;
+            enter = false;
+            if (atom == last){
+                for (int i=0; i<lengths[atom]; i++){
+                    int ent = rows[atom][i];
+                    // IO and target checking
+                    if (!substitutions.contains(ent) && targetEntity==ent){
+                        reachedTarget = true;
+                        // if we are not tracking groundings, we can stop as we know
+                        // that the rule predicted the target triple, thats all we care about
+                        if (!groundings){
+                            return;
+                        }
+                        Triple triple;
+                        if (dirs[atom-1]){
+                            triple = {currEntity, currRel, ent};
+                        }else{
+                            triple = {ent, currRel, currEntity};
+                        }
+                        currentGroundings.push_back(triple);
+                        if (!invertGrounding){
+                            (*groundings)[this].push_back(currentGroundings);
+                        }else{
+                            std::vector<Triple> reverseGr = currentGroundings;
+                            std::reverse(reverseGr.begin(), reverseGr.end());
+                            (*groundings)[this].push_back(reverseGr);
+                        }
+                        // now continue the loop, we want to find all the groundings
+                        currentGroundings.pop_back();
                     }
-                    
-                    // we have to pop here (for substitutions we dont add anything so we dont erase)
-                    currentGroundings.pop_back();
-                    // now continue the loop, we want to find all the groundings
-                }else{
-                    // if we are not tracking groundings, we can stop as we know
-                    // that the rule predicted the target triple, thats all we care about
-                    return;
-
                 }
+                lengths[atom] = 0;
+            }else if (branchingFactor>0 && lengths[atom]>branchingFactor){
+                lengths[atom] = 0;
             }
         }
-    }else{
-        if (branchingFactor>0 && length>branchingFactor){
-            return;
+        int* row = rows[atom];
+        int& pos = positions[atom];
+        while (pos < lengths[atom] && substitutions.contains(row[pos])){
+            pos++;
         }
-        //next entities
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            if (substitutions.find(ent)==substitutions.end()){
-                substitutions.insert(ent);
-                // we only track the groundings if groundings is given
-                if (groundings){
-                    Triple triple;
-                    if (dirs[currAtomIdx-1]){
-                        triple = {currEntity, currRel, ent};
-                    }else{
-                        triple = {ent, currRel, currEntity};
-                    }
-                    currentGroundings.push_back(triple);
+        if (pos < lengths[atom]){
+            int ent = row[pos++];
+            substitutions.push(ent);
+            // we only track the groundings if groundings is given
+            if (groundings){
+                Triple triple;
+                if (dirs[atom-1]){
+                    triple = {currEntity, currRel, ent};
+                }else{
+                    triple = {ent, currRel, currEntity};
                 }
-                searchCurrTargetGroundings(currAtomIdx+1, ent, substitutions, triples, targetEntity, rels, dirs, currentGroundings, groundings, reachedTarget, invertGrounding);
-                substitutions.erase(ent);
+                currentGroundings.push_back(triple);
+            }
+            atom++;
+            entities[atom] = ent;
+            enter = true;
+        }else{
+            scratch.release(marks[atom]);
+            atom--;
+            if (atom > 0){
+                substitutions.pop();
                 if (groundings){
                     currentGroundings.pop_back();
                 }
@@ -221,6 +391,9 @@ RuleB::RuleB(std::vector<int>& relations, std::vector<bool>& directions) {
     }
     if(relations.size() < 2) {
         throw std::invalid_argument("Cannot construct a RuleB with no body atom.");
+    }
+    if(relations.size() > Substitutions::MAX_BODY_LENGTH + 1) {
+        throw std::invalid_argument("Cannot construct a RuleB with more than " + std::to_string(Substitutions::MAX_BODY_LENGTH) + " body atoms.");
     }		
 	this->relations = relations;
     this->directions = directions;	
@@ -261,44 +434,40 @@ std::string RuleB::computeRuleString(Index* index){
 }
 
 void RuleB::materialize(TripleStorage& triples, std::unordered_set<Triple>& preds){
-    RelNodeToNodes* relNtoN = nullptr;
+    int* starts;
+    int numStarts;
      // first body atom is (v1,v2)
     if (directions[0]){
-         relNtoN =  &triples.getRelHeadToTails();
+         triples.getHeads(relations[1], starts, numStarts);
     // first body atom is (v2,v1)    
     }else{
-         relNtoN =  &triples.getRelTailToHeads();
-    }
-    // first body relation
-    auto it = relNtoN->find(relations[1]);
-    if (!(it==relNtoN->end())){
-        NodeToNodes& NtoN = it->second;
-        // start branches of the DFS search
-        // every entity e that satisfies b1(e,someY) [or b1(someX, e)]
-        for (auto const& pair: NtoN){
-            const int& e = pair.first;
-            Nodes closingEntities;
-            std::set<int> substitutions = {e};
-            searchCurrGroundings(1, e, substitutions, triples, closingEntities, relations, directions);
-            for (const int& cEnt:  closingEntities){
-                Triple triple = {e, targetRel, cEnt};
-                auto isNew = preds.insert(triple);
-                // add to count if this triple is predicted for the first time
-                if (trackInMaterialize && isNew.second){
-                    predicted+=1;
-                    if (triples.contains(triple[0], triple[1], triple[2])){
-                        cpredicted += 1;
-                    }
+         triples.getTails(relations[1], starts, numStarts);
+    }
+    // start branches of the DFS search
+    // every entity e that satisfies b1(e,someY) [or b1(someX, e)]
+    for (int i=0; i<numStarts; i++){
+        const int& e = starts[i];
+        EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+        Substitutions substitutions = {e};
+        searchCurrGroundings(e, substitutions, triples, closingEntities, relations, directions, branchingFactor);
+        for (const int& cEnt:  closingEntities){
+            Triple triple = {e, targetRel, cEnt};
+            auto isNew = preds.insert(triple);
+            // add to count if this triple is predicted for the first time
+            if (trackInMaterialize && isNew.second){
+                predicted+=1;
+                if (triples.contains(triple[0], triple[1], triple[2])){
+                    cpredicted += 1;
                 }
             }
         }
     }
 }
 
-bool RuleB::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){ 
-    Nodes closingEntities;
-    std::set<int> substitutions = {head};
-    searchCurrGroundings(1, head, substitutions, triples, closingEntities, relations, directions);
+bool RuleB::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){ 
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    Substitutions substitutions = {head};
+    searchCurrGroundings(head, substitutions, triples, closingEntities, relations, directions, branchingFactor);
     bool madePred = false;
     for (const int& cEnt: closingEntities){ 
         if (!filterSet.contains(cEnt)){
@@ -311,10 +480,10 @@ bool RuleB::predictTailQuery(int head, TripleStorage& triples, QueryResults& tai
            
 }
 
-bool RuleB::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  ManySet filterSet){
-    Nodes closingEntities;
-    std::set<int> substitutions = {tail};
-    searchCurrGroundings(1, tail, substitutions, triples, closingEntities, _relations, _directions);
+bool RuleB::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  const FilterSet& filterSet){
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    Substitutions substitutions = {tail};
+    searchCurrGroundings(tail, substitutions, triples, closingEntities, _relations, _directions, branchingFactor);
     bool madePred = false;
     for (const int& cEnt: closingEntities){
         if (!filterSet.contains(cEnt)){
@@ -325,48 +494,21 @@ bool RuleB::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
     return madePred;
 }
 
-// recursive DFS from a startpoint currEntity, one substitution of the first body atom
-void RuleB::searchCurrGroundings(
-			int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-            Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs
-		)
-{
-    int currRel = rels[currAtomIdx];
-    int* begin;
-    int length;
+std::vector<int>& RuleB::getQueryRelations(bool dirIsTail){
+    return dirIsTail ? relations : _relations;
+}
 
-    dirs[currAtomIdx-1] ? triples.getTforHR(currEntity, currRel, begin, length) : triples.getHforTR(currEntity, currRel, begin, length);
-    if (currAtomIdx == rels.size()-1){
-        // next entities
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            // respect object identity constraint, stop if violated
-            if (substitutions.find(ent)==substitutions.end()){
-                    closingEntities.insert(ent);
-            }
-        }
-    }else{
-        if (branchingFactor>0 && length>branchingFactor){
-            return;
-        }
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            if (substitutions.find(ent)==substitutions.end()){
-                substitutions.insert(ent);
-                searchCurrGroundings(currAtomIdx+1, ent, substitutions, triples, closingEntities, rels, dirs);
-                substitutions.erase(ent);
-            }
-        }
-    }
+std::vector<bool>& RuleB::getQueryDirections(bool dirIsTail){
+    return dirIsTail ? directions : _directions;
 }
 
 bool RuleB::predictTriple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings)
 {   
 
     bool reachedTarget = false;
-    std::set<int> substitutions = {head};
+    Substitutions substitutions = {head};
     std::vector<Triple> currGroundings;
-    searchCurrTargetGroundings(1, head, substitutions, triples, tail, relations, directions, currGroundings, groundings, reachedTarget);
+    searchCurrTargetGroundings(head, substitutions, triples, tail, relations, directions, currGroundings, groundings, reachedTarget);
     // for simplicity we just use QueryResults here 
     // we have to remember when calling from the outside what the triple is
     if (reachedTarget){
@@ -383,6 +525,9 @@ RuleC::RuleC(std::vector<int>& relations, std::vector<bool>& directions, bool& l
     }
     if(relations.size() < 2) {
         throw std::invalid_argument("Cannot construct a RuleC with no body atom.");
+    }
+    if(relations.size() > Substitutions::MAX_BODY_LENGTH + 1) {
+        throw std::invalid_argument("Cannot construct a RuleC with more than " + std::to_string(Substitutions::MAX_BODY_LENGTH) + " body atoms.");
     }		
 	this->relations = relations;
     this->directions = directions;
@@ -476,38 +621,37 @@ void RuleC::materialize(TripleStorage& triples, std::unordered_set<Triple>& pred
     // if right is grounded we start with last body atom which then contains the second constant
     std::vector<int>& rels = leftC ? relations : _relations;
     std::vector<bool>& dirs = leftC ? directions: _directions;
-    RelNodeToNodes* relNtoN = nullptr;
+    int* begin;
+    int length;
+    RowScratch::Scope scope;
     if (dirs[0]){
-        relNtoN =  &triples.getRelHeadToTails();   
+        triples.getTforHR(constants[1], rels[1], begin, length);
     }else{
-        relNtoN =  &triples.getRelTailToHeads();
-    }
-    auto it = relNtoN->find(rels[1]);
-    if (it!=relNtoN->end()){
-        NodeToNodes& NtoN = it->second;
-        if (NtoN.count(constants[1])>0){
-            Nodes closingEntities;
-            // we enforce OI for both the constants, this is consistent with B rules
-            std::set<int> substitutions = {constants[0], constants[1]};
-            searchCurrGroundings(1, constants[1], substitutions, triples, closingEntities, rels, dirs);
-            for (const int& cEnt:  closingEntities){
-                bool isNew;
-                Triple triple;
-                if (leftC){
-                    triple = {constants[0], targetRel, cEnt};
-                    isNew = preds.insert(triple).second;
-                }else{
-                    triple = {cEnt, targetRel, constants[0]};
-                    isNew = preds.insert(triple).second;
+        triples.getHforTR(constants[1], rels[1], begin, length);
+    }
+    if (length>0){
+        EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+        // we enforce OI for both the constants, this is consistent with B rules
+        Substitutions substitutions = {constants[0], constants[1]};
+        // C rules are not cut by the branching factor
+        searchCurrGroundings(constants[1], substitutions, triples, closingEntities, rels, dirs, 0);
+        for (const int& cEnt:  closingEntities){
+            bool isNew;
+            Triple triple;
+            if (leftC){
+                triple = {constants[0], targetRel, cEnt};
+                isNew = preds.insert(triple).second;
+            }else{
+                triple = {cEnt, targetRel, constants[0]};
+                isNew = preds.insert(triple).second;
+            }
+            // if triple is predicted for the first time track stats
+            if (trackInMaterialize && isNew){
+                predicted += 1;
+                if (triples.contains(triple[0], triple[1], triple[2])){
+                    cpredicted += 1;
                 }
-                // if triple is predicted for the first time track stats
-                if (trackInMaterialize && isNew){
-                    predicted += 1;
-                    if (triples.contains(triple[0], triple[1], triple[2])){
-                        cpredicted += 1;
-                    }
 
-                }
             }
         }
     }
@@ -515,7 +659,7 @@ void RuleC::materialize(TripleStorage& triples, std::unordered_set<Triple>& pred
 
 // contrary to B rules we let the DFS run starting from the grounded constants of the rules body
 // and not from the grounded entity in the query 
-bool RuleC::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleC::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // can only predict my constant in the grounded direction
     if (leftC && head!=constants[0]){
         return false;
@@ -530,11 +674,12 @@ bool RuleC::predictTailQuery(int head, TripleStorage& triples, QueryResults& tai
 
     int* begin;
     int length;
+    RowScratch::Scope scope;
     dirs[0] ? triples.getTforHR(constants[1], rels[1], begin, length) : triples.getHforTR(constants[1], rels[1], begin, length);
     if (length>0){
-        Nodes closingEntities;
-        std::set<int> substitutions = {constants[0], constants[1]};
-        searchCurrGroundings(1, constants[1], substitutions, triples, closingEntities, rels, dirs);
+        EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+        Substitutions substitutions = {constants[0], constants[1]};
+        searchCurrGroundings(constants[1], substitutions, triples, closingEntities, rels, dirs, 0);
         bool madePred = false;
         for (const int& cEnt: closingEntities){
             // the rule is grounded at the tail so it can only predict this grounding
@@ -553,9 +698,7 @@ bool RuleC::predictTailQuery(int head, TripleStorage& triples, QueryResults& tai
 }
 
 
-bool RuleC::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
-    RelationalCSR* csr = triples.getCSR();
-
+bool RuleC::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // h(X,c) <-- b1(d,X) or h(X,c) <-- b1(X,d)
     // we want to only look up the body for X=head by looking from X=head to d and then predict c
     if (!leftC){
@@ -563,12 +706,9 @@ bool RuleC::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& t
         if (filterSet.contains(constants[0])){
             return false;
         }
-        int* begin;
-        int length;
         int bodyRel = this->relations[1];
-        directions[0] ? triples.getTforHR(head, bodyRel, begin, length) :  triples.getHforTR(head, bodyRel, begin, length);
-        int* end = begin + length;
-        if (std::binary_search(begin, end, constants[1]) && constants[0]!=head){
+        bool inBody = directions[0] ? triples.contains(head, bodyRel, constants[1]) : triples.contains(constants[1], bodyRel, head);
+        if (inBody && constants[0]!=head){
             tailResults.insertRule(constants[0], this);
             return true;
         }
@@ -577,6 +717,7 @@ bool RuleC::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& t
         int* begin;
         int length;
         int bodyRel = this->relations[1];
+        RowScratch::Scope scope;
         directions[0] ? triples.getTforHR(constants[1], bodyRel, begin, length) :  triples.getHforTR(constants[1], bodyRel, begin, length);
         bool predicted = false;
         for (int i=0; i<length; i++){
@@ -593,20 +734,16 @@ bool RuleC::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& t
 }
 
 
-bool RuleC::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  ManySet filterSet){
-    RelationalCSR* csr = triples.getCSR();
+bool RuleC::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  const FilterSet& filterSet){
     // h(c,Y) <-- b1(d,Y) or h(c,Y) <-- b1(Y,d)
     // we want to only look up the body for Y=tail by looking from Y=tail to d and then predict c
     if (leftC){
          if(filterSet.contains(constants[0])){
             return false;
         }
-        int* begin;
-        int length;
         int bodyRel = this->relations[1];
-        directions[0] ? csr->getHforTREfficient(tail, bodyRel, begin, length) :  csr->getTforHREfficient(tail, bodyRel, begin, length);
-        int* end = begin + length;
-        if (std::binary_search(begin, end, constants[1]) && constants[0]!=tail){
+        bool inBody = directions[0] ? triples.contains(constants[1], bodyRel, tail) : triples.contains(tail, bodyRel, constants[1]);
+        if (inBody && constants[0]!=tail){
             headResults.insertRule(constants[0], this);
             return true;
         }
@@ -616,7 +753,8 @@ bool RuleC::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& h
         int* begin;
         int length;
         int bodyRel = this->relations[1];
-        directions[0] ? csr->getHforTREfficient(constants[1], bodyRel, begin, length) :  csr->getTforHREfficient(constants[1], bodyRel, begin, length);
+        RowScratch::Scope scope;
+        directions[0] ? triples.getHforTR(constants[1], bodyRel, begin, length) :  triples.getTforHR(constants[1], bodyRel, begin, length);
         bool predicted = false;
         for (int i=0; i<length; i++){
             int cand = begin[i];
@@ -633,7 +771,7 @@ bool RuleC::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& h
 
 
 
-bool RuleC::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  ManySet filterSet){
+bool RuleC::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults,  const FilterSet& filterSet){
     // can only predict my constant in the grounded direction
     if (!leftC && tail!=constants[0]){
         return false;
@@ -654,11 +792,12 @@ bool RuleC::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
 
     int* begin;
     int length;
+    RowScratch::Scope scope;
     dirs[0] ? triples.getTforHR(constants[1], rels[1], begin, length) : triples.getHforTR(constants[1], rels[1], begin, length);
     if (length>0){
-        Nodes closingEntities;
-        std::set<int> substitutions = {constants[0], constants[1]};
-        searchCurrGroundings(1, constants[1], substitutions, triples, closingEntities, rels, dirs);
+        EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+        Substitutions substitutions = {constants[0], constants[1]};
+        searchCurrGroundings(constants[1], substitutions, triples, closingEntities, rels, dirs, 0);
         bool madePred = false;
         for (const int& cEnt: closingEntities){
             // the rule is grounded at the head so it can only predict this grounding
@@ -676,6 +815,52 @@ bool RuleC::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
     return false;
 }
 
+bool RuleC::usesQueryIndependentCands(int source, bool dirIsTail){
+    // with one body atom the queries only look up the rows of the constant
+    if (directions.size()==1){
+        return false;
+    }
+    // can only predict my constant in the grounded direction
+    return dirIsTail != leftC || source==constants[0];
+}
+
+void RuleC::computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands){
+    // same search as in predictTailQuery() and predictHeadQuery()
+    std::vector<int>& rels = leftC ? relations : _relations;
+    std::vector<bool>& dirs = leftC ? directions: _directions;
+    RowScratch::Scope scope;
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    Substitutions substitutions = {constants[0], constants[1]};
+    searchCurrGroundings(constants[1], substitutions, triples, closingEntities, rels, dirs, 0);
+    cands.assign(closingEntities.begin(), closingEntities.end());
+    // the query entity must be a closing entity, the rule predicts its constant then
+    if (dirIsTail != leftC){
+        std::sort(cands.begin(), cands.end());
+    }
+}
+
+bool RuleC::predictQueryWithCands(int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail){
+    // can only predict my constant in the grounded direction
+    if (dirIsTail == leftC && source!=constants[0]){
+        return false;
+    }
+    if (dirIsTail != leftC){
+        if (std::binary_search(cands.begin(), cands.end(), source) && !filterSet.contains(constants[0])){
+            results.insertRule(constants[0], this);
+            return true;
+        }
+        return false;
+    }
+    bool madePred = false;
+    for (const int& cEnt: cands){
+        if (!filterSet.contains(cEnt)){
+            results.insertRule(cEnt, this);
+            madePred = true;
+        }
+    }
+    return madePred;
+}
+
 bool RuleC::predictTriple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings){
    
     if (leftC && head!=constants[0]){
@@ -689,16 +874,17 @@ bool RuleC::predictTriple(int head, int tail, TripleStorage& triples, QueryResul
 
     int* begin;
     int length;
+    RowScratch::Scope scope;
     dirs[0] ? triples.getTforHR(constants[1], rels[1], begin, length) : triples.getHforTR(constants[1], rels[1], begin, length);
     bool reachedTarget = false;
-    std::set<int> substitutions = {constants[0], constants[1]};
+    Substitutions substitutions = {constants[0], constants[1]};
     std::vector<Triple> currGroundings;
     int targetEnt = leftC ? tail : head;
     // h(c,Y) <-- b1(d,A), b2(A,Y)
     // h(X,c) <-- b1(X,A), b2(A,d)
     // for both directions we start with the atom with the constant
     // so we have to invert groundings in both cases (given we want to return AnyBURL order) aka the true in last input param
-    searchCurrTargetGroundings(1, constants[1], substitutions, triples, targetEnt, rels, dirs, currGroundings, groundings, reachedTarget, true);
+    searchCurrTargetGroundings(constants[1], substitutions, triples, targetEnt, rels, dirs, currGroundings, groundings, reachedTarget, true);
     // for simplicity we just use QueryResults here; this also holds for U_c rules 
     // we have to remember when calling from the outside what the triple is
     if (reachedTarget){
@@ -711,41 +897,6 @@ bool RuleC::predictL1Triple(int head, int tail, TripleStorage& triples, QueryRes
     return false;
 }
 
-// same implementation as in RuleB except that rels dirs is used depending on leftC s.t.
-// directions can be handled
-void RuleC::searchCurrGroundings(
-			int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-            Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs
-		)
-{
-    int currRel = rels[currAtomIdx];
-    int* begin;
-    int length;
-
-    dirs[currAtomIdx-1] ? triples.getTforHR(currEntity, currRel, begin, length) : triples.getHforTR(currEntity, currRel, begin, length);
-    // last atom
-    if (currAtomIdx == rels.size()-1){
-        // next entities
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            // respect object identity constraint, stop if violated
-            if (substitutions.find(ent)==substitutions.end()){
-                    closingEntities.insert(ent);
-            }
-        }
-    }else{
-         //next entities
-         for (int i=0; i<length; i++){
-            int ent = begin[i];
-            if (substitutions.find(ent)==substitutions.end()){
-                substitutions.insert(ent);
-                searchCurrGroundings(currAtomIdx+1, ent, substitutions, triples, closingEntities, rels, dirs);
-                substitutions.erase(ent);
-            }
-        }
-    }
-}
-
 
 // ***RuleZ implementation*** 
 RuleZ::RuleZ(int& relation, bool& leftC, int& constant) {
@@ -775,7 +926,7 @@ std::string RuleZ::computeRuleString(Index* index){
 }
 
 
-bool RuleZ::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet){
+bool RuleZ::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet){
     if (leftC && !filterSet.contains(constant)){
         headResults.insertRule(constant, this);
         return true;
@@ -783,7 +934,7 @@ bool RuleZ::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
     return false;
 }
 
-bool RuleZ::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleZ::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
      if (!leftC && !filterSet.contains(constant)){
         tailResults.insertRule(constant, this);
         return true;
@@ -811,28 +962,25 @@ bool RuleZ::predictTriple(int head, int tail, TripleStorage& triples, QueryResul
 
 void RuleZ::materialize(TripleStorage& triples, std::unordered_set<Triple>& preds){
     // predict c when h(c,X)<-- given all h(--, a) in train and vice versa
-    RelNodeToNodes& relNtoN = leftC ? triples.getRelTailToHeads() : triples.getRelHeadToTails();
-    //TODO optimize
-    auto it = relNtoN.find(relation);
-    if (it!=relNtoN.end()){
-        NodeToNodes& NtoN = it->second;
-        for (auto const& pair: NtoN){
-            bool isNew;
-            Triple triple;
-            // source node 
-            const int& e = pair.first;
-            if (leftC){
-                triple = {constant, relation, e};
-                isNew = preds.insert(triple).second;
-            }else{
-                triple = {e, relation, constant};
-                isNew = preds.insert(triple).second;
-            }
-            if (trackInMaterialize && isNew){
-                predicted += 1;
-                if (triples.contains(triple[0], triple[1], triple[2])){
-                    cpredicted += 1;
-                }
+    int* sources;
+    int numSources;
+    leftC ? triples.getTails(relation, sources, numSources) : triples.getHeads(relation, sources, numSources);
+    for (int i=0; i<numSources; i++){
+        bool isNew;
+        Triple triple;
+        // source node 
+        const int& e = sources[i];
+        if (leftC){
+            triple = {constant, relation, e};
+            isNew = preds.insert(triple).second;
+        }else{
+            triple = {e, relation, constant};
+            isNew = preds.insert(triple).second;
+        }
+        if (trackInMaterialize && isNew){
+            predicted += 1;
+            if (triples.contains(triple[0], triple[1], triple[2])){
+                cpredicted += 1;
             }
         }
     }
@@ -855,6 +1003,9 @@ RuleD::RuleD(std::vector<int>& relations, std::vector<bool>& directions, bool& l
     }
     if(relations.size() < 2) {
         throw std::invalid_argument("Cannot construct a RuleD with no body atom.");
+    }
+    if(relations.size() > Substitutions::MAX_BODY_LENGTH + 1) {
+        throw std::invalid_argument("Cannot construct a RuleD with more than " + std::to_string(Substitutions::MAX_BODY_LENGTH) + " body atoms.");
     }		
     this->directions = directions;
     this->relations=relations;
@@ -930,86 +1081,118 @@ std::string RuleD::computeRuleString(Index* index){
 
 
 void RuleD::materialize(TripleStorage& triples, std::unordered_set<Triple>& preds){
-    RelNodeToNodes* relNtoN = nullptr;
+    int* starts;
+    int numStarts;
      // first body atom is (v1,v2)
     if (directions[0]){
-         relNtoN =  &triples.getRelHeadToTails();
+         triples.getHeads(relations[1], starts, numStarts);
     // first body atom is (v2,v1)    
     }else{
-         relNtoN =  &triples.getRelTailToHeads();
-    }
-     // first body relation
-    auto it = relNtoN->find(relations[1]);
-    if (!(it==relNtoN->end())){
-        NodeToNodes& NtoN = it->second;
-         // start branches of the DFS search
-         // every entity e that satisfies b1(e,someY) [or b1(someX, e)]
-         for (auto const& pair: NtoN){
-                const int& e = pair.first;
-                Nodes closingEntities;
-                std::set<int> substitutions = {e, constant};
-
-                if (e==constant){
-                    continue;
-                }
-                searchCurrGroundings(1, e, substitutions, triples, closingEntities, relations, directions);
-                for (const int& cEnt:  closingEntities){
-                    Triple triple;
-                    if (!leftC){
-                        triple = {e, targetRel, constant};
-                    }else{
-                        triple = {constant, targetRel, cEnt};
-                    }
-                    auto isNew = preds.insert(triple);
-                    // add to count if this triple is predicted for the first time
-                    if (trackInMaterialize && isNew.second){
-                        predicted+=1;
-                        if (triples.contains(triple[0], triple[1], triple[2])){
-                            cpredicted += 1;
-                        }
-                    }
-                }
+         triples.getTails(relations[1], starts, numStarts);
+    }
+    // the index marks the entities that can be predicted, the search from them is not needed
+    // for leftC this holds only without a branching factor, the search is cut from the other side then
+    if (!leftC && hasBodyIndex(triples)){
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            if (e!=constant && bodySatisfied[e]){
+                materializeTriple({e, targetRel, constant}, triples, preds);
             }
+        }
+        return;
     }
-}
-
-
-
-void RuleD::searchCurrGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-		Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs
-)
-{
-    int currRel = rels[currAtomIdx];
-    int* begin;
-    int length;
-
-    dirs[currAtomIdx-1] ? triples.getTforHR(currEntity, currRel, begin, length) : triples.getHforTR(currEntity, currRel, begin, length);
-    if (currAtomIdx == rels.size()-1){
-        // next entities
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            // respect object identity constraint, stop if violated
-            if (substitutions.find(ent)==substitutions.end()){
-                    closingEntities.insert(ent);
+    if (leftC && branchingFactor<=0 && hasBodyIndex(triples)){
+        _directions[0] ? triples.getHeads(_relations[1], starts, numStarts) : triples.getTails(_relations[1], starts, numStarts);
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            if (e!=constant && bodySatisfied[e]){
+                materializeTriple({constant, targetRel, e}, triples, preds);
             }
         }
-    }else{
-        if (branchingFactor>0 && length>branchingFactor){
-            return;
+        return;
+    }
+    // start branches of the DFS search
+    // every entity e that satisfies b1(e,someY) [or b1(someX, e)]
+    for (int i=0; i<numStarts; i++){
+        const int& e = starts[i];
+        EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+        Substitutions substitutions = {e, constant};
+
+        if (e==constant){
+            continue;
         }
-        for (int i=0; i<length; i++){
-            int ent = begin[i];
-            if (substitutions.find(ent)==substitutions.end()){
-                substitutions.insert(ent);
-                searchCurrGroundings(currAtomIdx+1, ent, substitutions, triples, closingEntities, rels, dirs);
-                substitutions.erase(ent);
+        searchCurrGroundings(e, substitutions, triples, closingEntities, relations, directions, branchingFactor);
+        for (const int& cEnt:  closingEntities){
+            Triple triple;
+            if (!leftC){
+                triple = {e, targetRel, constant};
+            }else{
+                triple = {constant, targetRel, cEnt};
             }
+            materializeTriple(triple, triples, preds);
         }
     }
 }
 
-bool RuleD::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet){
+void RuleD::materializeTriple(const Triple& triple, TripleStorage& triples, std::unordered_set<Triple>& preds){
+    auto isNew = preds.insert(triple);
+    // add to count if this triple is predicted for the first time
+    if (trackInMaterialize && isNew.second){
+        predicted+=1;
+        if (triples.contains(triple[0], triple[1], triple[2])){
+            cpredicted += 1;
+        }
+    }
+}
+
+void RuleD::buildBodyIndex(TripleStorage& triples){
+    bodyIndexVersion = 0;
+    bodySatisfied.clear();
+    constantClosing.clear();
+    if (directions.size()==1){
+        return;
+    }
+    // the search starts from the unbound head variable, see predictTailQuery() and predictHeadQuery()
+    std::vector<int>& rels = leftC ? _relations : relations;
+    std::vector<bool>& dirs = leftC ? _directions : directions;
+    bodySatisfied.assign(triples.getIndex()->getNodeSize(), false);
+    int* starts;
+    int numStarts;
+    dirs[0] ? triples.getHeads(rels[1], starts, numStarts) : triples.getTails(rels[1], starts, numStarts);
+    // only entities with the first body relation can satisfy the body
+    for (int i=0; i<numStarts; i++){
+        bodySatisfied[starts[i]] = satisfiesBody(starts[i], triples);
+    }
+    // predictTriple() also starts from the constant in the other direction
+    std::vector<int>& otherRels = leftC ? relations : _relations;
+    std::vector<bool>& otherDirs = leftC ? directions : _directions;
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    Substitutions substitutions = {constant, constant};
+    searchCurrGroundings(constant, substitutions, triples, closingEntities, otherRels, otherDirs, branchingFactor);
+    constantClosing.assign(closingEntities.begin(), closingEntities.end());
+    std::sort(constantClosing.begin(), constantClosing.end());
+    bodyIndexVersion = triples.getVersion();
+}
+
+bool RuleD::hasBodyIndex(TripleStorage& triples){
+    return bodyIndexVersion != 0 && bodyIndexVersion == triples.getVersion();
+}
+
+bool RuleD::satisfiesBody(int entity, TripleStorage& triples){
+    if (hasBodyIndex(triples)){
+        return bodySatisfied[entity];
+    }
+    std::vector<int>& rels = leftC ? _relations : relations;
+    std::vector<bool>& dirs = leftC ? _directions : directions;
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    Substitutions substitutions = {entity, constant};
+    searchCurrGroundings(entity, substitutions, triples, closingEntities, rels, dirs, branchingFactor);
+    return closingEntities.size()>0;
+}
+
+
+
+bool RuleD::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet){
     // h(X,d) <-- b1(X,A), b2(A,B), b3(B,C)
     //  leftC=false, relations=[h, b1, b2, b3], directions=[1,1,1]
     // h(d,Y) <-- b1(A,B), b2(B,C), b3(C,Y)
@@ -1028,40 +1211,27 @@ bool RuleD::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
     }
     // can only predict constant
     if (leftC){
-        std::set<int> substitutions = {constant, tail};
-        Nodes closingEntities;
-        searchCurrGroundings(1, tail, substitutions, triples, closingEntities, _relations, _directions);
-        if (closingEntities.size()>0){
+        if (satisfiesBody(tail, triples)){
             // filtering is checked above already
             headResults.insertRule(constant, this);
             //done, can only predict one thing
             return true;
         }
+        return false;
     }else{
-        RelNodeToNodes* relNtoN = nullptr;
-        if (directions[0]){
-            relNtoN =  &triples.getRelHeadToTails();
-          
-        }else{
-            relNtoN =  &triples.getRelTailToHeads();
-        }
+        int* starts;
+        int numStarts;
         // first body relation
-        auto it = relNtoN->find(relations[1]);
+        directions[0] ? triples.getHeads(relations[1], starts, numStarts) : triples.getTails(relations[1], starts, numStarts);
         bool predicted = false;
-        if (!(it==relNtoN->end())){
-            NodeToNodes& NtoN = it->second;
-            for (auto const& pair: NtoN){
-                const int& e = pair.first;
-                Nodes closingEntities;
-                std::set<int> substitutions = {e, constant};
-                if (e==constant){
-                    continue;
-                }
-                searchCurrGroundings(1, e, substitutions, triples, closingEntities, relations, directions);
-                if (closingEntities.size()>0 && !filterSet.contains(e)){
-                    headResults.insertRule(e, this);
-                    predicted = true;
-                }
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            if (e==constant){
+                continue;
+            }
+            if (satisfiesBody(e, triples) && !filterSet.contains(e)){
+                headResults.insertRule(e, this);
+                predicted = true;
             }
         }
         return predicted;
@@ -1069,7 +1239,7 @@ bool RuleD::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& hea
 }
 
 
-bool RuleD::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet){
+bool RuleD::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet){
     // h(X,c) <-- b1(X,A)
     // h(c,Y) <-- b1(A,Y)
     if (leftC){
@@ -1079,6 +1249,7 @@ bool RuleD::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& h
         if (constant==tail){
             return false;
         }
+        RowScratch::Scope scope;
         directions[0] ? triples.getHforTR(tail, bodyRel, begin, length) : triples.getTforHR(tail, bodyRel, begin, length);
         if (length>0){
             // filtering is checked  already
@@ -1094,6 +1265,7 @@ bool RuleD::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& h
             int bodyRel = relations[1];
             int* begin;
             int length;
+            RowScratch::Scope scope;
             directions[0] ? triples.getTforHR(i, bodyRel, begin, length) : triples.getHforTR(i, bodyRel, begin, length);
             if (length>0 && !filterSet.contains(i) && i!=constant){
                  headResults.insertRule(i, this);
@@ -1106,7 +1278,7 @@ bool RuleD::predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& h
 
     
 
-bool RuleD::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleD::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // h(X,c) <-- b1(X,A), b2(A,B), b3(B,C)
     //  leftC=false, relations=[h, b1, b2, b3], directions=[1,1,1]
     // h(c,Y) <-- b1(A,B), b2(B,C), b3(C,Y)
@@ -1126,48 +1298,86 @@ bool RuleD::predictTailQuery(int head, TripleStorage& triples, QueryResults& tai
 
     // can only predict constant for the tail
     if (!leftC){
-        std::set<int> substitutions = {constant, head};
-        Nodes closingEntities;
-        searchCurrGroundings(1, head, substitutions, triples, closingEntities, relations, directions);
-        if (closingEntities.size()>0){
+        if (satisfiesBody(head, triples)){
             // filtering is checked above already
             tailResults.insertRule(constant, this);
             //done, can only predict one thing
             return true;
         }
+        return false;
     } else {
         
         // we start from the last atom (using _relations _directions)
-        RelNodeToNodes* relNtoN = nullptr;
-        if (_directions[0]){
-            relNtoN =  &triples.getRelHeadToTails();
-          
-        }else{
-            relNtoN =  &triples.getRelTailToHeads();
-        }
-        // first body relation
-        auto it = relNtoN->find(_relations[1]);
+        int* starts;
+        int numStarts;
+        _directions[0] ? triples.getHeads(_relations[1], starts, numStarts) : triples.getTails(_relations[1], starts, numStarts);
         bool predicted = false;
-        if (!(it==relNtoN->end())){
-            NodeToNodes& NtoN = it->second;
-            for (auto const& pair: NtoN){
-                const int& e = pair.first;
-                Nodes closingEntities;
-                std::set<int> substitutions = {e, constant};
-                if (e==constant){
-                    continue;
-                }
-                searchCurrGroundings(1, e, substitutions, triples, closingEntities, _relations, _directions);
-                if (closingEntities.size()>0 && !filterSet.contains(e)){
-                    tailResults.insertRule(e, this);
-                    predicted = true;
-                }
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            if (e==constant){
+                continue;
+            }
+            if (satisfiesBody(e, triples) && !filterSet.contains(e)){
+                tailResults.insertRule(e, this);
+                predicted = true;
             }
         }
         return predicted;
     }
 }
 
+bool RuleD::usesQueryIndependentCands(int source, bool dirIsTail){
+    // the grounded direction only predicts the constant, the other one needs the constant as query entity
+    return dirIsTail == leftC && source==constant;
+}
+
+void RuleD::computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands){
+    cands.clear();
+    // as in predictL1TailQuery() (predictL1HeadQuery()), every entity with the body relation
+    if (directions.size()==1){
+        Index* index = triples.getIndex();
+        int bodyRel = relations[1];
+        bool tailOfBody = dirIsTail ? !directions[0] : directions[0];
+        for (int i=0; i<index->getNodeSize(); i++){
+            int* begin;
+            int length;
+            RowScratch::Scope scope;
+            tailOfBody ? triples.getTforHR(i, bodyRel, begin, length) : triples.getHforTR(i, bodyRel, begin, length);
+            if (length>0 && i!=constant){
+                cands.push_back(i);
+            }
+        }
+        return;
+    }
+    // as in predictTailQuery() (predictHeadQuery()), every start entity with a grounding of the body
+    std::vector<int>& rels = dirIsTail ? _relations : relations;
+    std::vector<bool>& dirs = dirIsTail ? _directions : directions;
+    int* starts;
+    int numStarts;
+    dirs[0] ? triples.getHeads(rels[1], starts, numStarts) : triples.getTails(rels[1], starts, numStarts);
+    for (int i=0; i<numStarts; i++){
+        const int& e = starts[i];
+        if (e!=constant && satisfiesBody(e, triples)){
+            cands.push_back(e);
+        }
+    }
+}
+
+bool RuleD::predictQueryWithCands(int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail){
+    // the query entity must be the constant in this direction (see usesQueryIndependentCands())
+    if (dirIsTail!=leftC || source!=constant){
+        return false;
+    }
+    bool predicted = false;
+    for (const int& e: cands){
+        if (!filterSet.contains(e)){
+            results.insertRule(e, this);
+            predicted = true;
+        }
+    }
+    return predicted;
+}
+
 bool RuleD::predictTriple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings){
     // h(X,c) <-- b1(X,A), b2(A,B), b3(B,C)
     //  leftC=false, relations=[h, b1, b2, b3], directions=[1,1,1]
@@ -1182,31 +1392,33 @@ bool RuleD::predictTriple(int head, int tail, TripleStorage& triples, QueryResul
         return false;
     }
 
+    // the search of the other direction reaches the same entities when it is not cut by a branching factor
+    // only it may also start from the constant
+    if (!groundings && branchingFactor<=0 && hasBodyIndex(triples)){
+        int target = leftC ? tail : head;
+        if (target!=constant && (bodySatisfied[target] || std::binary_search(constantClosing.begin(), constantClosing.end(), target))){
+            qResults.insertRule(tail, this);
+            return true;
+        }
+        return false;
+    }
+
     bool reachedTarget = false;
     // for leftC we start with the first body atom and move to the last atom
     // if we hit a Y=tail(==targetEnt) we can stop (if not tracking groundings) 
     if (leftC){
-        RelNodeToNodes* relNtoN = nullptr;
-        if (directions[0]){
-            relNtoN =  &triples.getRelHeadToTails();
-          
-        }else{
-            relNtoN =  &triples.getRelTailToHeads();
-        }
-
-        auto it = relNtoN->find(relations[1]);
-        if (!(it==relNtoN->end())){
-            NodeToNodes& NtoN = it->second;
-            for (auto const& pair: NtoN){
-                const int& e = pair.first;
-                std::set<int> substitutions = {e, constant};
-                std::vector<Triple> currGroundings;
-                searchCurrTargetGroundings(1, e, substitutions, triples, tail, relations, directions, currGroundings, groundings, reachedTarget, true);
-                // stop after hitting tail once when we not track groundings
-                if (!groundings && reachedTarget){
-                    qResults.insertRule(tail, this);
-                    return true;
-                }
+        int* starts;
+        int numStarts;
+        directions[0] ? triples.getHeads(relations[1], starts, numStarts) : triples.getTails(relations[1], starts, numStarts);
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            Substitutions substitutions = {e, constant};
+            std::vector<Triple> currGroundings;
+            searchCurrTargetGroundings(e, substitutions, triples, tail, relations, directions, currGroundings, groundings, reachedTarget, true);
+            // stop after hitting tail once when we not track groundings
+            if (!groundings && reachedTarget){
+                qResults.insertRule(tail, this);
+                return true;
             }
         }
         if (reachedTarget){
@@ -1215,27 +1427,18 @@ bool RuleD::predictTriple(int head, int tail, TripleStorage& triples, QueryResul
         return reachedTarget;
     // not leftC we move from last atom to first atom and see if we hit the head
     } else{
-         RelNodeToNodes* relNtoN = nullptr;
-         if (_directions[0]){
-            relNtoN =  &triples.getRelHeadToTails();
-          
-        }else{
-            relNtoN =  &triples.getRelTailToHeads();
-        }
-
-        auto it = relNtoN->find(_relations[1]);
-        if (!(it==relNtoN->end())){
-            NodeToNodes& NtoN = it->second;
-            for (auto const& pair: NtoN){
-                const int& e = pair.first;
-                std::set<int> substitutions = {e, constant};
-                std::vector<Triple> currGroundings;
-                searchCurrTargetGroundings(1, e, substitutions, triples, head, _relations, _directions, currGroundings, groundings, reachedTarget, true);
-                // stop after hitting tail once when we not track groundings
-                if (!groundings && reachedTarget){
-                    qResults.insertRule(tail, this);
-                    return true;
-                }
+        int* starts;
+        int numStarts;
+        _directions[0] ? triples.getHeads(_relations[1], starts, numStarts) : triples.getTails(_relations[1], starts, numStarts);
+        for (int i=0; i<numStarts; i++){
+            const int& e = starts[i];
+            Substitutions substitutions = {e, constant};
+            std::vector<Triple> currGroundings;
+            searchCurrTargetGroundings(e, substitutions, triples, head, _relations, _directions, currGroundings, groundings, reachedTarget, true);
+            // stop after hitting tail once when we not track groundings
+            if (!groundings && reachedTarget){
+                qResults.insertRule(tail, this);
+                return true;
             }
         }
         if (reachedTarget){
@@ -1247,7 +1450,7 @@ bool RuleD::predictTriple(int head, int tail, TripleStorage& triples, QueryResul
 }
 
 
-bool RuleD::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleD::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // h(X,c) <-- b1(X,A)
     // h(c,Y) <-- b1(A,Y)
      if (!leftC){
@@ -1258,6 +1461,7 @@ bool RuleD::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& t
         if (constant==head){
             return false;
         }
+        RowScratch::Scope scope;
         !directions[0] ? triples.getHforTR(head, bodyRel, begin, length) : triples.getTforHR(head, bodyRel, begin, length);
         if (length>0){
             // filtering is checked  already
@@ -1273,6 +1477,7 @@ bool RuleD::predictL1TailQuery(int head, TripleStorage& triples, QueryResults& t
             int bodyRel = relations[1];
             int* begin;
             int length;
+            RowScratch::Scope scope;
             !directions[0] ? triples.getTforHR(i, bodyRel, begin, length) : triples.getHforTR(i, bodyRel, begin, length);
             if (length>0 && !filterSet.contains(i) && i!=constant){
                  tailResults.insertRule(i, this);
@@ -1300,7 +1505,7 @@ RuleXXd::RuleXXd(std::vector<int>& relations, std::vector<bool>& directions) {
 
     // only used and set after a rule is contructed and parsed from AnyBURL rule files
     this->predictHead = true;
-    this->predictHead = true;
+    this->predictTail = true;
 
     type = "xxd";
 }
@@ -1331,6 +1536,7 @@ bool RuleXXd::predictTriple(int head, int tail, TripleStorage& triples, QueryRes
     int length;
     int* begin;
     int bodyRel = this->relations[1];
+    RowScratch::Scope scope;
     directions[0] ? triples.getTforHR(head, bodyRel, begin, length) :  triples.getHforTR(tail, bodyRel, begin, length); //head==tail anyways
     if (length>0 && !groundings){
         qResults.insertRule(tail, this);
@@ -1353,7 +1559,7 @@ bool RuleXXd::predictTriple(int head, int tail, TripleStorage& triples, QueryRes
 }
 
 
-bool RuleXXd::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet){
+bool RuleXXd::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet){
     // h(X,X) <-- b(X,A)
     // h(X,X) <-- b(A,X)
     if (!predictHead){
@@ -1362,6 +1568,7 @@ bool RuleXXd::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& h
     int length;
     int* begin;
     int bodyRel = this->relations[1];
+    RowScratch::Scope scope;
     directions[0] ? triples.getTforHR(tail, bodyRel, begin, length) :  triples.getHforTR(tail, bodyRel, begin, length);
     if (length>0 && !filterSet.contains(tail)){
         headResults.insertRule(tail, this);
@@ -1371,7 +1578,7 @@ bool RuleXXd::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& h
 }
 
 
-bool RuleXXd::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleXXd::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // h(X,X) <-- b(X,A)
     // h(X,X) <-- b(A,X)
     if (!predictTail){
@@ -1381,6 +1588,7 @@ bool RuleXXd::predictTailQuery(int head, TripleStorage& triples, QueryResults& t
     int* begin;
     
     int bodyRel = this->relations[1];
+    RowScratch::Scope scope;
     directions[0] ? triples.getTforHR(head, bodyRel, begin, length) :  triples.getHforTR(head, bodyRel, begin, length);
     if (length>0 && !filterSet.contains(head)){
         tailResults.insertRule(head, this);
@@ -1397,6 +1605,7 @@ void RuleXXd::materialize(TripleStorage& triples, std::unordered_set<Triple>& pr
         int bodyRel = relations[1];
         int* begin;
         int length;
+        RowScratch::Scope scope;
         directions[0] ? triples.getTforHR(i, bodyRel, begin, length) : triples.getHforTR(i, bodyRel, begin, length);
         if (length>0){
             Triple triple = {i, targetRel, i};
@@ -1430,7 +1639,7 @@ RuleXXc::RuleXXc(std::vector<int>& relations, std::vector<bool>& directions, int
 
     // only used and set after a rule is contructed and parsed from AnyBURL rule files
     this->predictHead = true;
-    this->predictHead = true;
+    this->predictTail = true;
 
     type = "xxc";
 }
@@ -1450,12 +1659,10 @@ bool RuleXXc::predictTriple(int head, int tail, TripleStorage& triples, QueryRes
     if (head!=tail){
         return false;
     }
-    int length;
-    int* begin;
     int bodyRel = this->relations[1];
-    directions[0] ? triples.getTforHR(head, bodyRel, begin, length) :  triples.getHforTR(tail, bodyRel, begin, length); //head==tail
-    int* end = begin + length;
-    if (std::binary_search(begin, end, constant)){
+    //head==tail
+    bool inBody = directions[0] ? triples.contains(head, bodyRel, constant) : triples.contains(constant, bodyRel, tail);
+    if (inBody){
         if (groundings){
             std::vector<Triple> oneGrounding;
             if (directions[0]){
@@ -1476,18 +1683,15 @@ bool RuleXXc::predictTriple(int head, int tail, TripleStorage& triples, QueryRes
 
 
 
-bool RuleXXc::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet){
+bool RuleXXc::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet){
     // h(X,X) <-- b(X,d)
     // h(X,X) <-- b(d,X)
     if (!predictHead){
         return false;
     }
-    int length;
-    int* begin;
     int bodyRel = this->relations[1];
-    directions[0] ? triples.getTforHR(tail, bodyRel, begin, length) :  triples.getHforTR(tail, bodyRel, begin, length);
-    int* end = begin + length;
-    if (std::binary_search(begin, end, constant) && !filterSet.contains(tail)){
+    bool inBody = directions[0] ? triples.contains(tail, bodyRel, constant) : triples.contains(constant, bodyRel, tail);
+    if (inBody && !filterSet.contains(tail)){
         headResults.insertRule(tail, this);
         return true;
     }
@@ -1495,18 +1699,15 @@ bool RuleXXc::predictHeadQuery(int tail, TripleStorage& triples, QueryResults& h
 }
 
 
-bool RuleXXc::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet){
+bool RuleXXc::predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet){
     // h(X,X) <-- b(X,d)
     // h(X,X) <-- b(d,X)
     if (!predictTail){
         return false;
     }
-    int length;
-    int* begin;
     int bodyRel = this->relations[1];
-    directions[0] ? triples.getTforHR(head, bodyRel, begin, length) :  triples.getHforTR(head, bodyRel, begin, length);
-    int* end = begin + length;
-    if (std::binary_search(begin, end, constant) && !filterSet.contains(head)){
+    bool inBody = directions[0] ? triples.contains(head, bodyRel, constant) : triples.contains(constant, bodyRel, head);
+    if (inBody && !filterSet.contains(head)){
         tailResults.insertRule(head, this);
         return true;
     }
@@ -1528,6 +1729,7 @@ void RuleXXc::materialize(TripleStorage& triples, std::unordered_set<Triple>& pr
     int bodyRel = relations[1];
     int* begin;
     int length;
+    RowScratch::Scope scope;
     directions[0] ? triples.getHforTR(constant, bodyRel, begin, length) : triples.getTforHR(constant, bodyRel, begin, length);
     for (int i=0; i<length; i++){
         Triple triple = {begin[i], targetRel, begin[i]};
@@ -14,11 +14,46 @@
 
 #include "Types.h"
 #include "TripleStorage.h"
-#include "ManySet.h"
+#include "FilterSet.h"
+#include "EntityCollector.h"
 #include "QueryResults.h"
 #include "Index.h"
 
 
+// the entities that are bound in the current branch of the DFS over the body atoms (object identity)
+// bodies are short, a linear scan over an inline array is faster than a set and does not allocate
+class Substitutions
+{
+public:
+	// the rules check it in their constructors, a branch binds at most 2 start entities and one per inner atom
+	static const int MAX_BODY_LENGTH = 14;
+
+	Substitutions(std::initializer_list<int> start) {
+		for (int ent : start) {
+			push(ent);
+		}
+	}
+	bool contains(int ent) const {
+		for (int i=0; i<size; i++) {
+			if (entities[i] == ent) {
+				return true;
+			}
+		}
+		return false;
+	}
+	void push(int ent) {
+		entities[size++] = ent;
+	}
+	void pop() {
+		size--;
+	}
+
+private:
+	int entities[MAX_BODY_LENGTH + 1];
+	int size = 0;
+};
+
+
 class Rule 
 {
 public:
@@ -35,7 +70,9 @@ public:
 		trackInMaterialize(false),
 		confWeight(1.0),
 		numUnseen(5),
-		branchingFactor(-1)
+		branchingFactor(-1),
+		confidence(0.0),
+		rank(-1)
 	{
     std::ostringstream ss;
     ss << static_cast<const void*>(this);
@@ -47,7 +84,12 @@ public:
 	//Getter
 	int getID();
 	double getConfidence(int nUnseen, bool exact=false);
+	// the sampled confidence (exact=false) is kept up to date by the setters, it is not computed again
 	double getConfidence(bool exact=false);
+	// position in the order of application of all rules that are used (see RuleStorage::sortRelRules())
+	// comparing the ranks of two rules is the same as comparing them with compareRule
+	int getRank() const { return rank; }
+	void setRank(int val) { rank = val; }
 	void setStats(int cpredicted, int predicted, bool exact=false);
 	std::array<int,2> getStats(bool exact=false);
 	std::string getRuleString();
@@ -64,12 +106,25 @@ public:
 	// make prediction for partly grounded triples r(s,?) and r(?,o)
 	// we directly store the results in a query based result structure NodeToPredRults
 	virtual bool predictHeadQuery(
-		int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet()
+		int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet()
 		);
 	virtual bool predictTailQuery(
-		int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet()
+		int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet()
 	);
 
+	// some rules make the same candidates for every query entity (e.g. U_c rules search from their constant)
+	// the candidates can be computed once per direction and shared by all queries (see ClosingSetCache)
+	// true if the query for source is answered with these candidates
+	virtual bool usesQueryIndependentCands(int source, bool dirIsTail);
+	virtual void computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands);
+	// same as predictTailQuery() (predictHeadQuery()) with the candidates from computeQueryIndependentCands()
+	virtual bool predictQueryWithCands(
+		int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail
+	);
+
+	// precomputes what the rule looks up in the triples for every query, see RuleD (nothing for the other rules)
+	virtual void buildBodyIndex(TripleStorage& triples);
+
 	// predict a triple; can track groundings if groundings is not null
 	// see documentation of child classes
 	virtual bool predictTriple(
@@ -126,13 +181,27 @@ protected:
 
 	int branchingFactor;
 
+	// sampled confidence with numUnseen and confWeight, see updateConfidence()
+	double confidence;
+	int rank;
+	void updateConfidence();
 
-	// recursive DFS step with optional grounding tracking and a target closing entity (for scoring triples)
+
+	// DFS over the body atoms rels[1..] starting from startEntity, all entities reached by the last atom
+	// that respect the object identity constraint are closing entities
+	// branches with more than maxBranching entities at an inner atom are cut, 0 for no cut
+	// iterative with the state of every atom in inline arrays, used by B, C and D rules
+	void searchCurrGroundings(
+		int startEntity, Substitutions& substitutions, TripleStorage& triples,
+		EntityCollector& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs, int maxBranching
+	);
+
+	// DFS with optional grounding tracking and a target closing entity (for scoring triples)
     // used for scoring triples, e.g., DFS search but with a target end point (targetEntity)
     // can also be used to track all the groundings (list of triples) 
 	// used by B, C and D rules
 	void searchCurrTargetGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
+		int startEntity, Substitutions& substitutions, TripleStorage& triples,
 		int targetEntity, std::vector<int>& rels, std::vector<bool>& dirs, std::vector<Triple>& currentGroundings,
 		RuleGroundings* groundings, bool& reachedTarget, bool invertGrounding=false
 	);
@@ -165,8 +234,11 @@ public:
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
 	// we directly store the results in a query based result structure NodeToPredRults
 	//head query: tail given predict heads; vice versa for head query
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	// the relations and directions in the order they are searched from the query entity (see RuleTrie)
+	std::vector<int>& getQueryRelations(bool dirIsTail);
+	std::vector<bool>& getQueryDirections(bool dirIsTail);
 
 	// predict triple and optionally tracks grounding
 	// uses searchCurrTargetGroundings()
@@ -199,11 +271,6 @@ private:
 	std::vector<int> _relations;
 	std::vector<bool> _directions;
 	
-	// vanilla recursive DFS step
-	void searchCurrGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-		Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs 
-	);
 };
 
 
@@ -214,11 +281,16 @@ public:
 	RuleC(std::vector<int>& relations, std::vector<bool>& directions, bool& leftC, std::array<int, 2>& constants);
 	//TODO return semantics
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
-	bool predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	bool predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
 
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
-	bool predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+	bool predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+
+	// the closing entities of the search from constants[1], sorted when only the query entity is looked up
+	bool usesQueryIndependentCands(int source, bool dirIsTail);
+	void computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands);
+	bool predictQueryWithCands(int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail);
 	
 	// predict triple and optionally tracks grounding
 	// uses searchCurrTargetGroundings()
@@ -249,11 +321,6 @@ private:
 	std::vector<int> _relations;
 	std::vector<bool> _directions;
 
-	void searchCurrGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-		Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs
-	);
-
 	bool predictL1Triple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings);
 
 };
@@ -270,8 +337,8 @@ public:
 	RuleZ(int& relation, bool& leftC, int& constant);
 	//TODO return semantics
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
 	double getConfidence(int nUnseen, bool exact);
 	std::string computeRuleString(Index* index);
 	// predict triple (grounding tracking returns empty vector)
@@ -295,10 +362,19 @@ class RuleD: public Rule
 public:
 	RuleD(std::vector<int>& relations, std::vector<bool>& directions, bool& leftC, int constant);
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
-	bool predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
-	bool predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	bool predictL1HeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+	bool predictL1TailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
+
+	// in the direction of the unbound head variable every entity is tried as a start of the body
+	bool usesQueryIndependentCands(int source, bool dirIsTail);
+	void computeQueryIndependentCands(TripleStorage& triples, bool dirIsTail, std::vector<int>& cands);
+	bool predictQueryWithCands(int source, const std::vector<int>& cands, QueryResults& results, const FilterSet& filterSet, bool dirIsTail);
+
+	// marks every entity that grounds the unbound head variable such that the body is satisfied,
+	// the queries then test a bit instead of searching the body (rules with one body atom need no index)
+	void buildBodyIndex(TripleStorage& triples);
 
 	// predict triple and optionally tracks grounding
 	// uses searchCurrTargetGroundings()
@@ -312,10 +388,18 @@ private:
 	std::vector<int> _relations;
 	std::vector<bool> _directions;
 
-	void searchCurrGroundings(
-		int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
-		Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs
-	);
+	// body index, valid for the triples with version bodyIndexVersion (TripleStorage::getVersion())
+	// bodySatisfied[e]: the search from e (relations for !leftC, _relations for leftC) finds a closing entity
+	std::vector<bool> bodySatisfied;
+	// closing entities (sorted) of the search from the constant in the other direction
+	// predictTriple() starts there as well, the queries do not
+	std::vector<int> constantClosing;
+	uint64_t bodyIndexVersion = 0;
+	bool hasBodyIndex(TripleStorage& triples);
+	// true if the body has a grounding with entity for the unbound head variable, uses the index if it is valid
+	bool satisfiesBody(int entity, TripleStorage& triples);
+	void materializeTriple(const Triple& triple, TripleStorage& triples, std::unordered_set<Triple>& preds);
+
 };
 
 
@@ -325,8 +409,8 @@ public:
 	RuleXXd(std::vector<int>& relations, std::vector<bool>& directions);
 	void setPredictHead(bool ind);
 	void setPredictTail(bool ind);
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
 	std::string computeRuleString(Index* index);
 	bool predictTriple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings);
@@ -341,8 +425,8 @@ public:
 	RuleXXc(std::vector<int>& relations, std::vector<bool>& directions, int& constant);
 	void setPredictHead(bool ind);
 	void setPredictTail(bool ind);
-	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, ManySet filterSet=ManySet());
-	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, ManySet filterSet=ManySet());
+	bool predictHeadQuery(int tail, TripleStorage& triples, QueryResults& headResults, const FilterSet& filterSet=FilterSet());
+	bool predictTailQuery(int head, TripleStorage& triples, QueryResults& tailResults, const FilterSet& filterSet=FilterSet());
 	void materialize(TripleStorage& triples, std::unordered_set<Triple>& preds);
 	std::string computeRuleString(Index* index);
 	bool predictTriple(int head, int tail, TripleStorage& triples, QueryResults& qResults, RuleGroundings* groundings);
@@ -0,0 +1,27 @@
+#include "RuleBlocks.h"
+
+#include <stdexcept>
+
+
+RuleBlocks::RuleBlocks(const std::vector<Rule*>& rules){
+    order.reserve(rules.size());
+    for (Rule* rule : rules){
+        bool known = add(rule, bRules, B) || add(rule, cRules, C) || add(rule, dRules, D)
+            || add(rule, zRules, Z) || add(rule, xxdRules, XXD) || add(rule, xxcRules, XXC);
+        if (!known){
+            throw std::runtime_error("The type of a rule is not known to the rule application.");
+        }
+    }
+}
+
+
+template<class T>
+bool RuleBlocks::add(Rule* rule, std::vector<T*>& block, Kind kind){
+    T* typed = dynamic_cast<T*>(rule);
+    if (!typed){
+        return false;
+    }
+    order.push_back({kind, (int) block.size()});
+    block.push_back(typed);
+    return true;
+}
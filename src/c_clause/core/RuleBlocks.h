@@ -0,0 +1,107 @@
+#ifndef RULEBLOCKS_H
+#define RULEBLOCKS_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Rule.h"
+#include "TripleStorage.h"
+#include "QueryResults.h"
+#include "FilterSet.h"
+
+
+// the rules of one head relation in the order in which they are applied, grouped by their type
+// every type has its own contiguous array, the order refers to the position in the array of the type
+// the application calls the predict functions of the type directly (not through the vtable)
+class RuleBlocks {
+
+    public:
+        enum Kind : uint8_t {B, C, D, Z, XXD, XXC};
+
+        // rules in the order in which they are applied
+        RuleBlocks(const std::vector<Rule*>& rules);
+
+        int size() const {
+            return order.size();
+        }
+        Kind kind(int position) const {
+            return order[position].kind;
+        }
+        Rule* rule(int position) const;
+
+        // the candidates of C and D rules may not depend on the query (see Rule::usesQueryIndependentCands())
+        bool usesQueryIndependentCands(int position, int source, bool dirIsTail) const;
+
+        // predictTailQuery() (predictHeadQuery()) of the rule at position
+        bool predict(
+            int position, bool dirIsTail, int source, TripleStorage& triples, QueryResults& results, const FilterSet& filterSet
+        ) const;
+
+    private:
+        struct Entry {
+            Kind kind;
+            int index;
+        };
+        std::vector<Entry> order;
+
+        std::vector<RuleB*> bRules;
+        std::vector<RuleC*> cRules;
+        std::vector<RuleD*> dRules;
+        std::vector<RuleZ*> zRules;
+        std::vector<RuleXXd*> xxdRules;
+        std::vector<RuleXXc*> xxcRules;
+
+        // appends rule to block if it has the type T
+        template<class T>
+        bool add(Rule* rule, std::vector<T*>& block, Kind kind);
+};
+
+
+inline Rule* RuleBlocks::rule(int position) const {
+    const Entry& entry = order[position];
+    switch (entry.kind){
+        case B: return bRules[entry.index];
+        case C: return cRules[entry.index];
+        case D: return dRules[entry.index];
+        case Z: return zRules[entry.index];
+        case XXD: return xxdRules[entry.index];
+        default: return xxcRules[entry.index];
+    }
+}
+
+inline bool RuleBlocks::usesQueryIndependentCands(int position, int source, bool dirIsTail) const {
+    const Entry& entry = order[position];
+    switch (entry.kind){
+        case C: return cRules[entry.index]->RuleC::usesQueryIndependentCands(source, dirIsTail);
+        case D: return dRules[entry.index]->RuleD::usesQueryIndependentCands(source, dirIsTail);
+        default: return false;
+    }
+}
+
+inline bool RuleBlocks::predict(
+    int position, bool dirIsTail, int source, TripleStorage& triples, QueryResults& results, const FilterSet& filterSet
+) const {
+    const Entry& entry = order[position];
+    switch (entry.kind){
+        case B:
+            return dirIsTail ? bRules[entry.index]->RuleB::predictTailQuery(source, triples, results, filterSet)
+                : bRules[entry.index]->RuleB::predictHeadQuery(source, triples, results, filterSet);
+        case C:
+            return dirIsTail ? cRules[entry.index]->RuleC::predictTailQuery(source, triples, results, filterSet)
+                : cRules[entry.index]->RuleC::predictHeadQuery(source, triples, results, filterSet);
+        case D:
+            return dirIsTail ? dRules[entry.index]->RuleD::predictTailQuery(source, triples, results, filterSet)
+                : dRules[entry.index]->RuleD::predictHeadQuery(source, triples, results, filterSet);
+        case Z:
+            return dirIsTail ? zRules[entry.index]->RuleZ::predictTailQuery(source, triples, results, filterSet)
+                : zRules[entry.index]->RuleZ::predictHeadQuery(source, triples, results, filterSet);
+        case XXD:
+            return dirIsTail ? xxdRules[entry.index]->RuleXXd::predictTailQuery(source, triples, results, filterSet)
+                : xxdRules[entry.index]->RuleXXd::predictHeadQuery(source, triples, results, filterSet);
+        default:
+            return dirIsTail ? xxcRules[entry.index]->RuleXXc::predictTailQuery(source, triples, results, filterSet)
+                : xxcRules[entry.index]->RuleXXc::predictHeadQuery(source, triples, results, filterSet);
+    }
+}
+
+#endif // RULEBLOCKS_H
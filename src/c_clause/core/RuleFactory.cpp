@@ -553,7 +553,7 @@ void RuleFactory::parseAtom(const std::string& input, strAtom& atom) {
 
 // update (create new) relToRules based on options and all rules in rules
 // note that rules remains unchanged e.g. the global ruleset is the one from initial rule loading
-void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::unordered_map<int, std::set<Rule*,compareRule>>& relToRules){
+void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::unordered_map<int, std::vector<Rule*>>& relToRules){
     relToRules.clear();
     int numNew = 0;
 
@@ -581,7 +581,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
             }
             r->setBranchingFactor(BbranchingFactor);
             r->setNumUnseen(BnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else if ((strcmp(type, "c")==0)){
@@ -602,7 +602,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
             }           
             r->setBranchingFactor(DbranchingFactor);
             r->setNumUnseen(CnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else if ((strcmp(type, "d")==0)){
@@ -623,7 +623,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
             }   
             r->setConfWeight(DconfWeight);
             r->setNumUnseen(DnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else if ((strcmp(type, "z")==0)){
@@ -641,7 +641,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
             }      
             r->setConfWeight(ZconfWeight);
             r->setNumUnseen(ZnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else if ((strcmp(type, "xxd")==0)){
@@ -658,7 +658,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
                 continue;
             }     
             r->setNumUnseen(XXDnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else if ((strcmp(type, "xxc")==0)){
@@ -675,7 +675,7 @@ void RuleFactory::updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::un
                 continue;
             }         
             r->setNumUnseen(XXCnumUnseen);
-            relToRules[r->getTargetRel()].insert(r.get());
+            relToRules[r->getTargetRel()].push_back(r.get());
             numNew += 1;
 
         } else {
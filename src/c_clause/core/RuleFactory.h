@@ -31,7 +31,7 @@ public:
     void parseSymAtom(strAtom& inputAtom, symAtom& symA);
 
     // updates relToRules based on the set rule options and rules; rules is unchanged
-    void updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::unordered_map<int, std::set<Rule*,compareRule>>& relToRules);
+    void updateRules(std::vector<std::unique_ptr<Rule>>& rules, std::unordered_map<int, std::vector<Rule*>>& relToRules);
 
     
     void setCreateRuleB(bool ind);
@@ -10,6 +10,7 @@
 #include <iomanip>
 #include <unordered_set>
 #include <cctype>
+#include <algorithm>
 #include <omp.h>
 
 
@@ -138,23 +139,42 @@ void RuleStorage::readAnyTimeParFormat(std::string path, bool exact, int numThre
             hashToRule[ruleHash] = rules_ptr[i].get();
             
             // must be done after id is set
-            relToRules[rules_ptr[i]->getTargetRel()].insert(rules_ptr[i].get());
+            relToRules[rules_ptr[i]->getTargetRel()].push_back(rules_ptr[i].get());
             currID += 1;
             rules.push_back(std::move(rules_ptr[i]));
         }
     }
+    sortRelRules();
     std::cout<<"Loaded and indexed "<<currID<<" rules."<<std::endl;
     printStatistics();
 }
 
-std::set<Rule*, compareRule>& RuleStorage::getRelRules(int relation){
+const std::vector<Rule*>& RuleStorage::getRelRules(int relation){
     return relToRules[relation];
 }
 
-std::unordered_map<int, std::set<Rule*,compareRule>>& RuleStorage::getRelToRules(){
+std::unordered_map<int, std::vector<Rule*>>& RuleStorage::getRelToRules(){
     return relToRules;
 }
 
+// the confidences are cached in the rules, the ranks follow the same order over all relations
+void RuleStorage::sortRelRules(){
+    std::vector<Rule*> used;
+    for (auto& relRules : relToRules){
+        used.insert(used.end(), relRules.second.begin(), relRules.second.end());
+    }
+    std::sort(used.begin(), used.end(), compareRule());
+    for (std::unique_ptr<Rule>& rule : rules){
+        rule->setRank(-1);
+    }
+    for (int i=0; i<used.size(); i++){
+        used[i]->setRank(i);
+    }
+    for (auto& relRules : relToRules){
+        std::sort(relRules.second.begin(), relRules.second.end(), [](Rule* a, Rule* b){ return a->getRank() < b->getRank(); });
+    }
+}
+
 std::vector<std::unique_ptr<Rule>>& RuleStorage::getRules(){
     return rules;
  }
@@ -201,6 +221,14 @@ void RuleStorage::clearAll(){
     ruleHashToCombos.clear();
 }
 
+// the rules only read the triples, every rule builds its own index
+void RuleStorage::buildBodyIndex(TripleStorage& triples, int numThreads){
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+    for (int i=0; i<rules.size(); i++){
+        rules[i]->buildBodyIndex(triples);
+    }
+}
+
 void RuleStorage::printStatistics() {
     // Count rules by type
     std::unordered_map<std::string, int> ruleTypeCounts;
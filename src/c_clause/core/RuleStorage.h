@@ -42,9 +42,14 @@ public:
     }
 
     std::vector<std::unique_ptr<Rule>>& getRules();
-    std::unordered_map<int, std::set<Rule*,compareRule>>& getRelToRules();
-    std::set<Rule*, compareRule>& getRelRules(int relation);
+    std::unordered_map<int, std::vector<Rule*>>& getRelToRules();
+    // the rules of the relation in the order in which they are applied
+    const std::vector<Rule*>& getRelRules(int relation);
+    // sorts the rules of every relation with compareRule and sets the ranks, must be called after relToRules changed
+    void sortRelRules();
     void clearAll();
+    // precomputes for the triples what the rules look up for every query (see Rule::buildBodyIndex()), in parallel
+    void buildBodyIndex(TripleStorage& triples, int numThreads);
     
     // Combo-related methods
     void addCombo(std::unique_ptr<Combo> combo);
@@ -63,7 +68,8 @@ private:
     // as we need to be able to come back to larger sets after subsetting
     std::vector<std::unique_ptr<Rule>> rules;
     // from here rule application is performed; application is always based on a target relation
-    std::unordered_map<int, std::set<Rule*,compareRule>> relToRules;
+    // sorted once after loading (updating), see sortRelRules()
+    std::unordered_map<int, std::vector<Rule*>> relToRules;
     std::shared_ptr<Index> index;
     // TODO you dont really need a shared pointer here; but at least options should be global 
     std::shared_ptr<RuleFactory> ruleFactory;
@@ -0,0 +1,178 @@
+#include "RuleTrie.h"
+
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+#include "EntityCollector.h"
+#include "RowCodec.hpp"
+
+
+namespace {
+    // object identity, the query entity and the entities of the path are bound
+    inline bool isBound(int entity, int source, const int* path, int depth){
+        if (entity == source){
+            return true;
+        }
+        for (int i=0; i<depth; i++){
+            if (path[i] == entity){
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+
+RuleTrie::RuleTrie(const std::vector<Rule*>& relRules, bool dirIsTail){
+    this->dirIsTail = dirIsTail;
+    // (parent, relation, direction, branching factor) -> node
+    std::map<std::tuple<int, int, bool, int>, int> children;
+    std::vector<int> numRules;
+    for (Rule* rule : relRules){
+        RuleB* ruleB = dynamic_cast<RuleB*>(rule);
+        int node = -1;
+        // rules with one body atom have no inner atoms
+        if (ruleB && ruleB->getRelations().size() > 2){
+            std::vector<int>& rels = ruleB->getQueryRelations(dirIsTail);
+            std::vector<bool>& dirs = ruleB->getQueryDirections(dirIsTail);
+            // the last atom is searched by every rule itself
+            for (int atom=1; atom<rels.size()-1; atom++){
+                auto key = std::make_tuple(node, rels[atom], (bool) dirs[atom-1], ruleB->getBranchingFactor());
+                auto child = children.find(key);
+                if (child == children.end()){
+                    nodes.push_back({node, atom, rels[atom], dirs[atom-1], ruleB->getBranchingFactor()});
+                    numRules.push_back(0);
+                    child = children.emplace(key, nodes.size() - 1).first;
+                }
+                node = child->second;
+                numRules[node]++;
+            }
+        }
+        rules.push_back(ruleB);
+        ruleNodes.push_back(node);
+    }
+    // a rule that shares not even its first atom is applied as usual
+    bool shared = false;
+    for (int& node : ruleNodes){
+        if (node < 0){
+            continue;
+        }
+        int first = node;
+        while (nodes[first].parent >= 0){
+            first = nodes[first].parent;
+        }
+        if (numRules[first] < 2){
+            node = -1;
+        }else{
+            shared = true;
+        }
+    }
+    if (!shared){
+        nodes.clear();
+    }
+}
+
+
+RuleTrie::Frontiers::Frontiers(const RuleTrie& trie){
+    stamps.assign(trie.nodes.size(), 0);
+    paths.resize(trie.nodes.size());
+    tooLarge.assign(trie.nodes.size(), false);
+}
+
+void RuleTrie::Frontiers::clear(){
+    epoch++;
+    // wrapped around, old stamps could be taken for the new epoch
+    if (epoch == 0){
+        std::fill(stamps.begin(), stamps.end(), 0);
+        epoch = 1;
+    }
+}
+
+
+bool RuleTrie::expand(int node, int source, TripleStorage& triples, Frontiers& frontiers) const {
+    if (frontiers.stamps[node] == frontiers.epoch){
+        return !frontiers.tooLarge[node];
+    }
+    frontiers.stamps[node] = frontiers.epoch;
+    frontiers.tooLarge[node] = true;
+    std::vector<int>& paths = frontiers.paths[node];
+    paths.clear();
+
+    const Node& curr = nodes[node];
+    int parentDepth = curr.depth - 1;
+    const int* parentPaths = nullptr;
+    // the first inner atom starts from the (empty) path of the query entity
+    size_t numParentPaths = 1;
+    if (curr.parent >= 0){
+        if (!expand(curr.parent, source, triples, frontiers)){
+            return false;
+        }
+        parentPaths = frontiers.paths[curr.parent].data();
+        numParentPaths = frontiers.paths[curr.parent].size() / parentDepth;
+    }
+    // same order and branching factor cut as in Rule::searchCurrGroundings()
+    for (size_t p=0; p<numParentPaths; p++){
+        const int* path = parentPaths + p * parentDepth;
+        int currEntity = parentDepth == 0 ? source : path[parentDepth-1];
+        RowScratch::Scope scope;
+        int* begin;
+        int length;
+        curr.direction ? triples.getTforHR(currEntity, curr.relation, begin, length) : triples.getHforTR(currEntity, curr.relation, begin, length);
+        if (curr.branchingFactor>0 && length>curr.branchingFactor){
+            continue;
+        }
+        for (int i=0; i<length; i++){
+            if (!isBound(begin[i], source, path, parentDepth)){
+                paths.insert(paths.end(), path, path + parentDepth);
+                paths.push_back(begin[i]);
+            }
+        }
+        if (paths.size() > (size_t) MAX_PATHS_SIZE){
+            paths.clear();
+            return false;
+        }
+    }
+    frontiers.tooLarge[node] = false;
+    return true;
+}
+
+
+bool RuleTrie::predict(
+    int position, int source, TripleStorage& triples, QueryResults& results,
+    const FilterSet& filterSet, Frontiers& frontiers
+) const {
+    RuleB* rule = rules[position];
+    int node = ruleNodes[position];
+    if (!expand(node, source, triples, frontiers)){
+        return dirIsTail ? rule->predictTailQuery(source, triples, results, filterSet) : rule->predictHeadQuery(source, triples, results, filterSet);
+    }
+    std::vector<int>& rels = rule->getQueryRelations(dirIsTail);
+    std::vector<bool>& dirs = rule->getQueryDirections(dirIsTail);
+    int last = rels.size() - 1;
+    int depth = nodes[node].depth;
+
+    EntityCollector& closingEntities = EntityCollector::local(triples.getIndex()->getNodeSize());
+    const std::vector<int>& paths = frontiers.paths[node];
+    for (size_t p=0; p<paths.size(); p+=depth){
+        const int* path = paths.data() + p;
+        RowScratch::Scope scope;
+        int* begin;
+        int length;
+        dirs[last-1] ? triples.getTforHR(path[depth-1], rels[last], begin, length) : triples.getHforTR(path[depth-1], rels[last], begin, length);
+        for (int i=0; i<length; i++){
+            if (!isBound(begin[i], source, path, depth)){
+                closingEntities.insert(begin[i]);
+            }
+        }
+    }
+    // as in RuleB::predictTailQuery()
+    bool madePred = false;
+    for (const int& cEnt : closingEntities){
+        if (!filterSet.contains(cEnt)){
+            results.insertRule(cEnt, rule);
+            madePred = true;
+        }
+    }
+    return madePred;
+}
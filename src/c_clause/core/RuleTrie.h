@@ -0,0 +1,75 @@
+#ifndef RULETRIE_H
+#define RULETRIE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "Rule.h"
+#include "TripleStorage.h"
+#include "QueryResults.h"
+#include "FilterSet.h"
+
+
+// the B rules of one head relation for one query direction, arranged by their inner body atoms
+// a node is a sequence of inner atoms (relation, direction), rules with the same first atoms share the nodes
+// for a query the paths (the entities bound to the inner variables) of a node are searched once, every rule
+// below the node continues from them; the rules are still applied one after another in their order,
+// such that the QueryResults are the same as when every rule searches on its own (Rule::searchCurrGroundings())
+class RuleTrie {
+
+    public:
+        // the paths of a node are not kept above this many entities, the rules below search on their own
+        static const int MAX_PATHS_SIZE = 1 << 18;
+
+        // rules in the order in which they are applied
+        RuleTrie(const std::vector<Rule*>& rules, bool dirIsTail);
+
+        // the rules at these positions are applied with predict(), the others as usual
+        bool contains(int position) const {
+            return ruleNodes[position] >= 0;
+        }
+        bool empty() const {
+            return nodes.empty();
+        }
+
+        // the paths of every node for the current query, one per thread
+        struct Frontiers {
+            Frontiers(const RuleTrie& trie);
+            // next query
+            void clear();
+
+            uint32_t epoch = 1;
+            // the paths of a node are valid if the stamp of the node is the epoch
+            std::vector<uint32_t> stamps;
+            // paths of depth entities each, in the order the DFS would find them
+            std::vector<std::vector<int>> paths;
+            std::vector<bool> tooLarge;
+        };
+
+        // same as predictTailQuery() (predictHeadQuery()) of the rule at position
+        bool predict(
+            int position, int source, TripleStorage& triples, QueryResults& results,
+            const FilterSet& filterSet, Frontiers& frontiers
+        ) const;
+
+    private:
+        struct Node {
+            // -1 for the first inner atom, the path starts at the query entity then
+            int parent;
+            int depth;
+            int relation;
+            bool direction;
+            int branchingFactor;
+        };
+        std::vector<Node> nodes;
+
+        // per position of a rule
+        std::vector<RuleB*> rules;
+        std::vector<int> ruleNodes;
+        bool dirIsTail;
+
+        // computes the paths of node if they are not there yet, false if they are too large
+        bool expand(int node, int source, TripleStorage& triples, Frontiers& frontiers) const;
+};
+
+#endif // RULETRIE_H
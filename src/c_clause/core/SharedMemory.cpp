@@ -0,0 +1,216 @@
+#include "SharedMemory.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <streambuf>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+    const char SEGMENT_MAGIC[8] = {'C','L','A','U','S','E','S','M'};
+
+    // only counts the bytes, for the size of the segment
+    class CountingBuffer : public std::streambuf {
+        public:
+            size_t count = 0;
+        protected:
+            std::streamsize xsputn(const char*, std::streamsize n) override {
+                count += n;
+                return n;
+            }
+            int_type overflow(int_type c) override {
+                if (!traits_type::eq_int_type(c, traits_type::eof())){
+                    count += 1;
+                }
+                return traits_type::not_eof(c);
+            }
+    };
+
+    // writes into a fixed region, writing past its end fails the stream
+    class MemoryBuffer : public std::streambuf {
+        public:
+            MemoryBuffer(char* begin, size_t size){
+                setp(begin, begin + size);
+            }
+            size_t written(){
+                return pptr() - pbase();
+            }
+    };
+
+    // POSIX names start with a slash
+    std::string segmentName(std::string name){
+        return (!name.empty() && name[0] == '/') ? name : "/" + name;
+    }
+}
+
+
+// the first page of the segment, the snapshot starts at the second page such that it is mapped page aligned
+struct SharedMemory::Header {
+    char magic[8];
+    // set last by the publisher, the data is complete afterwards
+    std::atomic<int32_t> published;
+    std::atomic<int64_t> numReferences;
+    uint64_t dataSize;
+};
+
+
+SharedMemory::SharedMemory(std::string name){
+    this->name = segmentName(name);
+}
+
+#ifdef _WIN32
+
+std::shared_ptr<SharedMemory> SharedMemory::publish(std::string name, std::function<void(std::ostream&)> write){
+    throw std::runtime_error("Shared memory is not supported on Windows.");
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::attach(std::string name){
+    throw std::runtime_error("Shared memory is not supported on Windows.");
+}
+
+void SharedMemory::remove(std::string name){
+    throw std::runtime_error("Shared memory is not supported on Windows.");
+}
+
+SharedMemory::~SharedMemory(){
+}
+
+int64_t SharedMemory::getNumReferences(){
+    return 0;
+}
+
+#else
+
+std::shared_ptr<SharedMemory> SharedMemory::publish(std::string name, std::function<void(std::ostream&)> write){
+    CountingBuffer counter;
+    std::ostream counted(&counter);
+    write(counted);
+    size_t size = counter.count;
+
+    std::shared_ptr<SharedMemory> shm(new SharedMemory(name));
+    int fd = shm_open(shm->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0){
+        throw std::runtime_error(
+            "Unable to create the shared memory segment " + name
+            + (errno == EEXIST ? ", it exists already (it can be removed with remove_shared)." : ".")
+        );
+    }
+    try {
+        shm->headerSize = sysconf(_SC_PAGESIZE);
+        if (ftruncate(fd, shm->headerSize + size) != 0){
+            throw std::runtime_error("Unable to allocate " + std::to_string(size) + " bytes of shared memory for " + name + ".");
+        }
+        void* header = mmap(nullptr, shm->headerSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (header == MAP_FAILED){
+            throw std::runtime_error("Unable to map the shared memory segment " + name + ".");
+        }
+        shm->header = new (header) Header();
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, shm->headerSize);
+        if (data == MAP_FAILED){
+            throw std::runtime_error("Unable to map the shared memory segment " + name + ".");
+        }
+        shm->begin = static_cast<const char*>(data);
+        shm->length = size;
+
+        MemoryBuffer buffer(static_cast<char*>(data), size);
+        std::ostream out(&buffer);
+        write(out);
+        if (!out.good() || buffer.written() != size){
+            throw std::runtime_error("Failed to write the data into the shared memory segment " + name + ".");
+        }
+        // like a mapped snapshot file the data is read-only from now on
+        mprotect(data, size, PROT_READ);
+
+        std::memcpy(shm->header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        shm->header->dataSize = size;
+        shm->header->numReferences.store(1);
+        shm->referenced = true;
+        shm->header->published.store(1, std::memory_order_release);
+    } catch (...) {
+        close(fd);
+        shm_unlink(shm->name.c_str());
+        throw;
+    }
+    close(fd);
+    return shm;
+}
+
+std::shared_ptr<SharedMemory> SharedMemory::attach(std::string name){
+    std::shared_ptr<SharedMemory> shm(new SharedMemory(name));
+    int fd = shm_open(shm->name.c_str(), O_RDWR, 0);
+    if (fd < 0){
+        throw std::runtime_error("Unable to open the shared memory segment " + name + ", it has to be published first.");
+    }
+    try {
+        shm->headerSize = sysconf(_SC_PAGESIZE);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < shm->headerSize){
+            throw std::runtime_error("The shared memory segment " + name + " is not published completely.");
+        }
+        void* header = mmap(nullptr, shm->headerSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (header == MAP_FAILED){
+            throw std::runtime_error("Unable to map the shared memory segment " + name + ".");
+        }
+        shm->header = static_cast<Header*>(header);
+        if (shm->header->published.load(std::memory_order_acquire) != 1
+            || std::memcmp(shm->header->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0){
+            throw std::runtime_error("The shared memory segment " + name + " is not published completely.");
+        }
+        // a reference can only be taken while someone else holds one, without any the segment is being removed
+        int64_t numReferences = shm->header->numReferences.load();
+        do {
+            if (numReferences <= 0){
+                throw std::runtime_error("The shared memory segment " + name + " is being removed.");
+            }
+        } while (!shm->header->numReferences.compare_exchange_weak(numReferences, numReferences + 1));
+        shm->referenced = true;
+
+        size_t size = shm->header->dataSize;
+        if ((size_t) st.st_size < shm->headerSize + size){
+            throw std::runtime_error("The shared memory segment " + name + " is truncated.");
+        }
+        void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, shm->headerSize);
+        if (data == MAP_FAILED){
+            throw std::runtime_error("Unable to map the shared memory segment " + name + ".");
+        }
+        shm->begin = static_cast<const char*>(data);
+        shm->length = size;
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return shm;
+}
+
+void SharedMemory::remove(std::string name){
+    if (shm_unlink(segmentName(name).c_str()) != 0 && errno != ENOENT){
+        throw std::runtime_error("Unable to remove the shared memory segment " + name + ".");
+    }
+}
+
+// the data is unmapped by ~MappedFile()
+SharedMemory::~SharedMemory(){
+    if (!header){
+        return;
+    }
+    if (referenced && header->numReferences.fetch_sub(1) == 1){
+        shm_unlink(name.c_str());
+    }
+    munmap(header, headerSize);
+}
+
+int64_t SharedMemory::getNumReferences(){
+    return header ? header->numReferences.load() : 0;
+}
+
+#endif
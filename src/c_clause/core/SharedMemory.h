@@ -0,0 +1,40 @@
+#ifndef SHAREDMEMORY_H
+#define SHAREDMEMORY_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "Util.hpp"
+
+// a data snapshot (see Snapshot.hpp) in a POSIX shared memory segment, such that worker processes on
+// one machine use a single copy of the data; the snapshot is mapped read-only and used in place like a snapshot file
+// every SharedMemory holds one reference that is counted in the segment, the last one that is destroyed removes the segment
+// a process that is killed does not release its reference, its segment stays until it is removed with remove()
+class SharedMemory : public util::MappedFile {
+
+    public:
+        // creates the segment and fills it with write, the segment must not exist yet
+        // write is called twice, the first time to measure the size
+        static std::shared_ptr<SharedMemory> publish(std::string name, std::function<void(std::ostream&)> write);
+        // the segment must have been published completely
+        static std::shared_ptr<SharedMemory> attach(std::string name);
+        // removes the segment name, processes that are attached keep their mapping
+        static void remove(std::string name);
+
+        ~SharedMemory();
+        // number of SharedMemory objects (in all processes) that use the segment
+        int64_t getNumReferences();
+
+    private:
+        struct Header;
+        SharedMemory(std::string name);
+        std::string name;
+        Header* header = nullptr;
+        size_t headerSize = 0;
+        // true once this object holds a reference
+        bool referenced = false;
+};
+
+#endif // SHAREDMEMORY_H
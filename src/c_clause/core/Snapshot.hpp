@@ -0,0 +1,114 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// binary snapshot of the loaded data (index, triple storages and their CSRs)
+// layout: header | index | storages, every array is written as [int64 count][elements][padding to 8 bytes]
+// such that all arrays are aligned when the file is mapped and can be used in place
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+namespace snapshot {
+
+    const char MAGIC[8] = {'C','L','A','U','S','E','S','N'};
+    // increase when the layout changes, old files are rejected then
+    const uint32_t VERSION = 6;
+    // written as is, reading it back with a different byte order gives a different value
+    const uint32_t ENDIANNESS = 0x01020304;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t intSize;
+        uint32_t reserved;
+    };
+
+    inline void writeBytes(std::ostream& out, const void* bytes, size_t numBytes){
+        out.write(static_cast<const char*>(bytes), numBytes);
+        static const char zeros[8] = {0};
+        out.write(zeros, (8 - numBytes % 8) % 8);
+    }
+
+    template<class T>
+    inline void writeArray(std::ostream& out, const T* arr, int64_t count){
+        out.write(reinterpret_cast<const char*>(&count), sizeof(int64_t));
+        writeBytes(out, arr, count * sizeof(T));
+    }
+
+    template<class T>
+    inline void writeValue(std::ostream& out, T value){
+        writeArray(out, &value, 1);
+    }
+
+    // sequential reader over a mapped snapshot, arrays are returned in place (no copy)
+    class Reader {
+        public:
+            Reader(const char* begin, size_t size): ptr(begin), end(begin + size) {}
+
+            template<class T>
+            const T* readArray(int64_t& count){
+                count = *reinterpret_cast<const int64_t*>(take(sizeof(int64_t)));
+                size_t numBytes = count * sizeof(T);
+                const T* arr = reinterpret_cast<const T*>(take(numBytes));
+                take((8 - numBytes % 8) % 8);
+                return arr;
+            }
+
+            template<class T>
+            T readValue(){
+                int64_t count;
+                const T* value = readArray<T>(count);
+                if (count != 1){
+                    throw std::runtime_error("Snapshot file is corrupted.");
+                }
+                return *value;
+            }
+
+            const char* take(size_t numBytes){
+                if (numBytes > (size_t)(end - ptr)){
+                    throw std::runtime_error("Snapshot file is truncated or corrupted.");
+                }
+                const char* current = ptr;
+                ptr += numBytes;
+                return current;
+            }
+
+        private:
+            const char* ptr;
+            const char* end;
+    };
+
+    inline void writeHeader(std::ostream& out){
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byteOrder = ENDIANNESS;
+        header.intSize = sizeof(int);
+        header.reserved = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    }
+
+    inline void checkHeader(Reader& reader){
+        Header header;
+        std::memcpy(&header, reader.take(sizeof(Header)), sizeof(Header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0){
+            throw std::runtime_error("File is not a data snapshot.");
+        }
+        if (header.version != VERSION){
+            throw std::runtime_error(
+                "Snapshot has version " + std::to_string(header.version) + " but version " + std::to_string(VERSION)
+                + " is required, please write the snapshot again from the original data."
+            );
+        }
+        if (header.byteOrder != ENDIANNESS || header.intSize != sizeof(int)){
+            throw std::runtime_error("Snapshot was written on a platform with a different byte order or int size.");
+        }
+    }
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,211 @@
+#include "StringDict.h"
+
+#include <cstring>
+#include <stdexcept>
+
+
+StringDict::StringDict() {
+	clear();
+}
+
+StringDict::StringDict(const StringDict& other) {
+	*this = other;
+}
+
+// the views of a copy point to its own vectors, a copied snapshot view stays a view
+StringDict& StringDict::operator=(const StringDict& other) {
+	chars = other.chars;
+	offsets = other.offsets;
+	slots = other.slots;
+	mask = other.mask;
+	numSlotsUsed = other.numSlotsUsed;
+	charsView = other.charsView;
+	offsetsView = other.offsetsView;
+	slotsView = other.slotsView;
+	numStrings = other.numStrings;
+	numChars = other.numChars;
+	isView = other.isView;
+	if (!isView) {
+		updateView();
+	}
+	return *this;
+}
+
+// FNV-1a
+uint64_t StringDict::hash(const char* str, size_t length) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i=0; i<length; i++) {
+		hash ^= (unsigned char) str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// slot of str or the empty slot where it would be inserted
+size_t StringDict::probe(const char* str, size_t length, uint32_t h) const {
+	size_t pos = h & mask;
+	while (slotsView[pos].id >= 0) {
+		const Slot& slot = slotsView[pos];
+		if (slot.hash == h) {
+			uint64_t begin = offsetsView[slot.id];
+			if (offsetsView[slot.id+1] - begin == length && std::memcmp(charsView + begin, str, length) == 0) {
+				return pos;
+			}
+		}
+		pos = (pos + 1) & mask;
+	}
+	return pos;
+}
+
+int StringDict::find(const char* str, size_t length) const {
+	return slotsView[probe(str, length, hash(str, length))].id;
+}
+
+int StringDict::add(const char* str, size_t length) {
+	own();
+	uint32_t h = hash(str, length);
+	size_t pos = probe(str, length, h);
+	if (slots[pos].id >= 0) {
+		return slots[pos].id;
+	}
+	append(str, length);
+	insertSlot(pos, h, size() - 1);
+	return size() - 1;
+}
+
+int StringDict::push(const char* str, size_t length) {
+	own();
+	uint32_t h = hash(str, length);
+	size_t pos = probe(str, length, h);
+	append(str, length);
+	if (slots[pos].id < 0) {
+		insertSlot(pos, h, size() - 1);
+	}
+	return size() - 1;
+}
+
+void StringDict::setLookup(const char* str, size_t length, int id) {
+	own();
+	uint32_t h = hash(str, length);
+	size_t pos = probe(str, length, h);
+	if (slots[pos].id >= 0) {
+		slots[pos].id = id;
+	} else {
+		insertSlot(pos, h, id);
+	}
+}
+
+void StringDict::append(const char* str, size_t length) {
+	chars.insert(chars.end(), str, str + length);
+	offsets.push_back(chars.size());
+	updateView();
+}
+
+void StringDict::insertSlot(size_t pos, uint32_t h, int id) {
+	slots[pos] = {h, id};
+	numSlotsUsed++;
+	// keep the load factor below 1/2
+	if (numSlotsUsed * 2 > slots.size()) {
+		grow();
+	}
+	updateView();
+}
+
+void StringDict::grow() {
+	std::vector<Slot> old;
+	old.swap(slots);
+	slots.assign(old.size() * 2, {0, -1});
+	mask = slots.size() - 1;
+	for (const Slot& slot : old) {
+		if (slot.id >= 0) {
+			size_t pos = slot.hash & mask;
+			while (slots[pos].id >= 0) {
+				pos = (pos + 1) & mask;
+			}
+			slots[pos] = slot;
+		}
+	}
+}
+
+std::string StringDict::get(int id) const {
+	if (id < 0 || id >= size()) {
+		throw std::out_of_range("Id " + std::to_string(id) + " is not in the index.");
+	}
+	return std::string(charsView + offsetsView[id], offsetsView[id+1] - offsetsView[id]);
+}
+
+int StringDict::size() const {
+	return numStrings;
+}
+
+void StringDict::clear() {
+	chars.clear();
+	offsets.assign(1, 0);
+	slots.assign(16, {0, -1});
+	mask = slots.size() - 1;
+	numSlotsUsed = 0;
+	isView = false;
+	updateView();
+}
+
+void StringDict::shrink() {
+	if (isView) {
+		return;
+	}
+	chars.shrink_to_fit();
+	offsets.shrink_to_fit();
+	updateView();
+}
+
+void StringDict::updateView() {
+	charsView = chars.data();
+	offsetsView = offsets.data();
+	slotsView = slots.data();
+	numStrings = offsets.size() - 1;
+	numChars = chars.size();
+	isView = false;
+}
+
+void StringDict::own() {
+	if (!isView) {
+		return;
+	}
+	chars.assign(charsView, charsView + numChars);
+	offsets.assign(offsetsView, offsetsView + numStrings + 1);
+	slots.assign(slotsView, slotsView + mask + 1);
+	numSlotsUsed = 0;
+	for (const Slot& slot : slots) {
+		numSlotsUsed += (slot.id >= 0);
+	}
+	updateView();
+}
+
+// the lookup table is written as well, such that a mapped snapshot can be used without rebuilding it
+void StringDict::write(std::ostream& out) const {
+	snapshot::writeArray(out, offsetsView, numStrings + 1);
+	snapshot::writeArray(out, charsView, numChars);
+	snapshot::writeArray(out, slotsView, mask + 1);
+}
+
+void StringDict::read(snapshot::Reader& reader) {
+	int64_t numOffsets;
+	const uint64_t* readOffsets = reader.readArray<uint64_t>(numOffsets);
+	int64_t numReadChars;
+	const char* readChars = reader.readArray<char>(numReadChars);
+	int64_t numSlots;
+	const Slot* readSlots = reader.readArray<Slot>(numSlots);
+	if (numOffsets < 1 || readOffsets[numOffsets-1] != (uint64_t) numReadChars
+		|| numSlots < 16 || (numSlots & (numSlots - 1)) != 0) {
+		throw std::runtime_error("Snapshot file is corrupted, invalid string table.");
+	}
+	chars = std::vector<char>();
+	offsets = std::vector<uint64_t>();
+	slots = std::vector<Slot>();
+	charsView = readChars;
+	offsetsView = readOffsets;
+	slotsView = readSlots;
+	numStrings = numOffsets - 1;
+	numChars = numReadChars;
+	mask = numSlots - 1;
+	isView = true;
+}
@@ -0,0 +1,72 @@
+#ifndef STRINGDICT_H
+#define STRINGDICT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Snapshot.hpp"
+
+// bidirectional string <-> id dictionary, ids are assigned in insertion order (0,1,2..)
+// all strings are stored once in a contiguous arena, id -> string is an offset lookup
+// string -> id is an open addressing table over the ids (no string copies)
+class StringDict {
+
+public:
+	StringDict();
+	StringDict(const StringDict& other);
+	StringDict& operator=(const StringDict& other);
+	StringDict(StringDict&& other) = default;
+	StringDict& operator=(StringDict&& other) = default;
+	// id of str, str is appended with the next id if it is not contained yet
+	int add(const char* str, size_t length);
+	// appends str with the next id also when it is contained already, find keeps returning the older id
+	int push(const char* str, size_t length);
+	// find(str) returns id afterwards, get(id) has to be str
+	void setLookup(const char* str, size_t length, int id);
+	// id of str or -1 if it is not contained
+	int find(const char* str, size_t length) const;
+	std::string get(int id) const;
+	int size() const;
+	void clear();
+	// release the memory reserved for growing
+	void shrink();
+
+	// arena, offsets (size()+1 entries, string i is chars[offsets[i]..offsets[i+1])) and the lookup table
+	void write(std::ostream& out) const;
+	// uses the arrays of a mapped snapshot in place, they have to outlive the dictionary
+	// or the next change, which copies them first
+	void read(snapshot::Reader& reader);
+
+private:
+	std::vector<char> chars;
+	std::vector<uint64_t> offsets;
+
+	// the (truncated) hash is kept in the slot such that the arena is only touched for hits
+	struct Slot {
+		uint32_t hash;
+		int id;
+	};
+	std::vector<Slot> slots;
+	size_t mask;
+	size_t numSlotsUsed;
+
+	// all lookups go through these, they point to the vectors above or to the arrays of a snapshot
+	const char* charsView;
+	const uint64_t* offsetsView;
+	const Slot* slotsView;
+	int numStrings;
+	size_t numChars;
+	bool isView = false;
+	void updateView();
+	// copies the arrays of a snapshot into the vectors before they are changed
+	void own();
+
+	static uint64_t hash(const char* str, size_t length);
+	size_t probe(const char* str, size_t length, uint32_t h) const;
+	void append(const char* str, size_t length);
+	void insertSlot(size_t pos, uint32_t h, int id);
+	void grow();
+};
+
+#endif // STRINGDICT_H
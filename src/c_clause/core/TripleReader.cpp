@@ -0,0 +1,180 @@
+#include "TripleReader.h"
+
+#include <omp.h>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "Util.hpp"
+
+
+TripleReader::TripleReader(int numThreads){
+    this->numThreads = std::max(1, numThreads);
+}
+
+TripleReader::InternTable::InternTable(){
+    slots.assign(1 << 10, {0, -1});
+    mask = slots.size() - 1;
+}
+
+// FNV-1a
+uint64_t TripleReader::InternTable::hash(const Token& token){
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint32_t i=0; i<token.length; i++){
+        hash ^= (unsigned char) token.begin[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int TripleReader::InternTable::intern(const Token& token, std::vector<Token>& tokens){
+    uint64_t h = hash(token);
+    size_t pos = h & mask;
+    while (slots[pos].id >= 0){
+        const Slot& slot = slots[pos];
+        if (slot.hash == h){
+            const Token& other = tokens[slot.id];
+            if (other.length == token.length && std::memcmp(other.begin, token.begin, token.length) == 0){
+                return slot.id;
+            }
+        }
+        pos = (pos + 1) & mask;
+    }
+    int id = tokens.size();
+    slots[pos] = {h, id};
+    tokens.push_back(token);
+    // keep the load factor below 1/2
+    if (tokens.size() * 2 > slots.size()){
+        grow();
+    }
+    return id;
+}
+
+void TripleReader::InternTable::grow(){
+    std::vector<Slot> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, {0, -1});
+    mask = slots.size() - 1;
+    for (const Slot& slot: old){
+        if (slot.id >= 0){
+            size_t pos = slot.hash & mask;
+            while (slots[pos].id >= 0){
+                pos = (pos + 1) & mask;
+            }
+            slots[pos] = slot;
+        }
+    }
+}
+
+
+void TripleReader::read(std::string filepath, Index& index, TripleSet& triples, bool addToIndex, bool strict){
+    util::MappedFile file(filepath);
+    const char* data = file.data();
+    size_t size = file.size();
+
+    // a few chunks per thread such that uneven chunks are balanced
+    int numChunks = size < (1 << 20) ? 1 : numThreads * 4;
+    std::vector<size_t> bounds(numChunks + 1, size);
+    bounds[0] = 0;
+    for (int i=1; i<numChunks; i++){
+        size_t pos = std::max(bounds[i-1], size / numChunks * i);
+        while (pos < size && data[pos-1] != '\n' && data[pos-1] != '\r'){
+            pos++;
+        }
+        bounds[i] = pos;
+    }
+
+    std::vector<Chunk> chunks(numChunks);
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+    for (int i=0; i<numChunks; i++){
+        parseChunk(data + bounds[i], data + bounds[i+1], chunks[i], strict);
+    }
+
+    int numMalformed = 0;
+    for (Chunk& chunk: chunks){
+        if (!chunk.error.empty()){
+            throw std::runtime_error(
+                "Error while reading " + filepath + ", please make sure every line follows the tab separated format"
+                " {subject}{TAB}{predicate}{TAB}{object}. Line: " + chunk.error
+            );
+        }
+        numMalformed += chunk.numMalformed;
+    }
+    if (numMalformed > 0){
+        std::cout << "Unsupported Filetype, please make sure you have the following triple format {subject}{TAB}{predicate}{TAB}{object}. "
+                  << numMalformed << " lines of " << filepath << " have more than 3 columns, only the first 3 are used." << std::endl;
+    }
+
+    // merge the local tables in chunk order, this keeps the id assignment deterministic (order of first occurrence)
+    std::vector<std::vector<int>> nodeIds(numChunks);
+    std::vector<std::vector<int>> relIds(numChunks);
+    std::vector<size_t> offsets(numChunks + 1, triples.size());
+    for (int i=0; i<numChunks; i++){
+        for (Token& token: chunks[i].nodes){
+            std::string node(token.begin, token.length);
+            nodeIds[i].push_back(addToIndex ? index.addNode(node) : index.getIdOfNodestring(node));
+        }
+        for (Token& token: chunks[i].relations){
+            std::string relation(token.begin, token.length);
+            relIds[i].push_back(addToIndex ? index.addRelation(relation) : index.getIdOfRelationstring(relation));
+        }
+        offsets[i+1] = offsets[i] + chunks[i].triples.size();
+    }
+
+    triples.resize(offsets[numChunks]);
+    #pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+    for (int i=0; i<numChunks; i++){
+        TripleSet& local = chunks[i].triples;
+        for (size_t j=0; j<local.size(); j++){
+            triples[offsets[i] + j] = {nodeIds[i][local[j][0]], relIds[i][local[j][1]], nodeIds[i][local[j][2]]};
+        }
+        TripleSet().swap(local);
+    }
+}
+
+
+void TripleReader::parseChunk(const char* begin, const char* end, Chunk& chunk, bool strict){
+    InternTable nodeToLocal;
+    InternTable relToLocal;
+
+    const char* pos = begin;
+    while (pos < end){
+        // lines end with \n, \r\n or \r; empty lines are skipped
+        const char* lineEnd = pos;
+        while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r'){
+            lineEnd++;
+        }
+        if (lineEnd > pos){
+            Token fields[3];
+            int numFields = 0;
+            const char* fieldBegin = pos;
+            for (const char* c=pos; c<=lineEnd; c++){
+                if (c == lineEnd || *c == '\t'){
+                    // like util::split a trailing tab does not open another (empty) field
+                    if (c == lineEnd && c == fieldBegin && numFields > 0){
+                        break;
+                    }
+                    if (numFields < 3){
+                        fields[numFields] = {fieldBegin, (uint32_t)(c - fieldBegin)};
+                    }
+                    numFields++;
+                    fieldBegin = c + 1;
+                }
+            }
+            if (numFields < 3 || (strict && numFields > 3)){
+                if (chunk.error.empty()){
+                    chunk.error = std::string(pos, lineEnd);
+                }
+                return;
+            }
+            if (numFields > 3){
+                chunk.numMalformed += 1;
+            }
+            int head = nodeToLocal.intern(fields[0], chunk.nodes);
+            int tail = nodeToLocal.intern(fields[2], chunk.nodes);
+            int relation = relToLocal.intern(fields[1], chunk.relations);
+            chunk.triples.push_back({head, relation, tail});
+        }
+        pos = lineEnd + 1;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef TRIPLEREADER_H
+#define TRIPLEREADER_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Index.h"
+#include "Types.h"
+
+// reads files with tab separated triples {head}{TAB}{relation}{TAB}{tail}
+// the file is memory mapped and split into line aligned chunks that are parsed in parallel
+// every chunk interns its strings into its own table (no locking), afterwards the tables are merged
+// in chunk order such that the ids are exactly the ones of reading the file line by line
+class TripleReader
+{
+public:
+    TripleReader(int numThreads);
+    // appends the triples of the file (as idx's) to triples
+    // addToIndex=true: unseen entities/relations are added to the index, otherwise an exception is thrown
+    // strict=true: lines with more than 3 columns throw as well, otherwise only the first 3 columns are used
+    void read(std::string filepath, Index& index, TripleSet& triples, bool addToIndex, bool strict=false);
+
+private:
+    int numThreads;
+
+    // a string inside the mapped file
+    struct Token {
+        const char* begin;
+        uint32_t length;
+    };
+
+    // open addressing token -> local id table of one chunk
+    // the full hash is stored in the slots such that the file is only touched for (almost certain) hits
+    class InternTable {
+    public:
+        InternTable();
+        // returns the local id of token, new tokens get the next id and are appended to tokens
+        int intern(const Token& token, std::vector<Token>& tokens);
+    private:
+        struct Slot {
+            uint64_t hash;
+            int id;
+        };
+        std::vector<Slot> slots;
+        size_t mask;
+        void grow();
+        static uint64_t hash(const Token& token);
+    };
+
+    struct Chunk {
+        // local id -> token, in the order of first occurrence
+        std::vector<Token> nodes;
+        std::vector<Token> relations;
+        // triples with local ids
+        TripleSet triples;
+        int numMalformed = 0;
+        // first line that could not be parsed, empty if there is none
+        std::string error;
+    };
+
+    void parseChunk(const char* begin, const char* end, Chunk& chunk, bool strict);
+};
+
+#endif // TRIPLEREADER_H
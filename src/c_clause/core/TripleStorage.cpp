@@ -2,61 +2,44 @@
 
 #include <fstream>
 #include <memory>
+#include <numeric>
+#include <algorithm>
 #include "TripleStorage.h"
+#include "TripleReader.h"
+
+std::atomic<uint64_t> TripleStorage::nextVersion(1);
 
 TripleStorage::TripleStorage(std::shared_ptr<Index> index) {
 	this->index = index;		
 	index->rehash();
-	for (int i = 0; i < index->getRelSize(); i++) {
-		relHeadToTails[i].rehash(relHeadToTails[i].size());
-		relTailToHeads[i].rehash(relTailToHeads[i].size());
-	}
-	relHeadToTails.rehash(relHeadToTails.size());
-	relTailToHeads.rehash(relTailToHeads.size());
 }
 
 
-RelationalCSR* TripleStorage::getCSR(){
-	return rcsr.get();
+void TripleStorage::setNumThreads(int num){
+	numThreads = num;
 }
 
-
-RelNodeToNodes& TripleStorage::getRelHeadToTails() {
-	return relHeadToTails;
+void TripleStorage::setCompressed(bool compressed){
+	this->compressed = compressed;
 }
 
-RelNodeToNodes& TripleStorage::getRelTailToHeads() {
-	return relTailToHeads;
+RelationalCSR* TripleStorage::getCSR(){
+	return rcsr.get();
 }
 
+
 // read a file with tab separated triples and create data
 // loadCSR is true per default, when multiple datasets are loaded it should be set to false
 // and after all the data is loaded (and the index is constructed) the csr should be loaded
 // with loadCSR() otherwise the CSR are bugged in cases where the set of entities of the different datasets differs
 void TripleStorage::read(std::string filepath, bool loadCSR) {
-	std::string line;
-	std::ifstream file(filepath);
-	if (file.is_open())
-	{
-		while (!util::safeGetline(file, line).eof())
-		{
-			std::istringstream iss(line);
-			std::vector<std::string> results = util::split(line, '\t');
-			if (results.size() != 3) {
-				std::cout << "Unsupported Filetype, please make sure you have the following triple format {subject}{TAB}{predicate}{TAB}{object}" << std::endl;
-				//exit(-1);
-			}
-			add(results[0], results[1], results[2]);
-		}
-		file.close();
-	}
-	else {
-		std::cout << "Unable to open file " << filepath << std::endl;
-		exit(-1);
-	}
+	size_t numBefore = pending.size();
+	TripleReader reader(numThreads);
+	reader.read(filepath, *index, pending, true);
+	size += pending.size() - numBefore;
 
 	if (loadCSR){
-		rcsr = std::make_unique<RelationalCSR>(index->getRelSize(), index->getNodeSize(), relHeadToTails, relTailToHeads);
+		this->loadCSR();
 	}
 }
 
@@ -66,35 +49,168 @@ void TripleStorage::read(std::vector<std::array<std::string, 3>> triples, bool l
 		add(triple[0], triple[1], triple[2]);
 	}
 	if (loadCSR){
-		rcsr = std::make_unique<RelationalCSR>(index->getRelSize(), index->getNodeSize(), relHeadToTails, relTailToHeads);
+		this->loadCSR();
 	}
 }
 
+// the entity ids are the ones of the api (see Index::toInternalNode())
 void TripleStorage::read(std::vector<std::array<int, 3>> triples, bool loadCSR) {
 	for(auto& triple : triples){
-		addIdx(triple[0], triple[1], triple[2]);
+		addIdx(index->toInternalNode(triple[0]), triple[1], index->toInternalNode(triple[2]));
 	}
 	if (loadCSR){
-		rcsr = std::make_unique<RelationalCSR>(index->getRelSize(), index->getNodeSize(), relHeadToTails, relTailToHeads);
+		this->loadCSR();
 	}
 }
 
+// the triples are directly sorted into the CSR, there is no other representation of the data
+// calling it again (after more triples were added) rebuilds the CSR with all triples
 void TripleStorage::loadCSR(){
-	rcsr = std::make_unique<RelationalCSR>(index->getRelSize(), index->getNodeSize(), relHeadToTails, relTailToHeads);
+	if (rcsr){
+		rcsr->getTriples(pending);
+	}
+	for (DeltaCSR* layer : {frozen.get(), delta.get()}){
+		if (layer){
+			pending.insert(pending.end(), layer->triples.begin(), layer->triples.end());
+		}
+	}
+	frozen.reset();
+	delta.reset();
+	layered = false;
+	setCSR(RelationalCSR::build(index->getRelSize(), index->getNodeSize(), pending, compressed));
+	resetTieRanks();
+	newVersion();
+}
+
+// the rows that change are copied into the delta, the CSR is not touched
+// triples that are already stored are skipped
+void TripleStorage::loadDelta(){
+	if (!rcsr){
+		loadCSR();
+		return;
+	}
+	if (!delta){
+		delta = std::make_unique<DeltaCSR>();
+	}
+	layered = true;
+	for (const Triple& triple : pending){
+		if (contains(triple[0], triple[1], triple[2])){
+			continue;
+		}
+		insertIntoDelta(triple[0], triple[1], false, triple[2]);
+		insertIntoDelta(triple[2], triple[1], true, triple[0]);
+		// one after the other such that a self loop counts twice as in the CSR
+		delta->degrees[triple[0]] = getFreq(triple[0]) + 1;
+		delta->degrees[triple[2]] = getFreq(triple[2]) + 1;
+		delta->triples.push_back(triple);
+	}
+	TripleSet().swap(pending);
+	resetTieRanks();
+	newVersion();
+}
+
+// target is not in the row yet
+void TripleStorage::insertIntoDelta(int source, int relation, bool inverse, int target){
+	auto row = delta->rows.find(DeltaCSR::rowKey(relation, inverse, source));
+	if (row == delta->rows.end()){
+		RowScratch::Scope scope;
+		int* begin;
+		int length;
+		getRow(relation, inverse, source, begin, length);
+		row = delta->rows.emplace(DeltaCSR::rowKey(relation, inverse, source), std::vector<int>(begin, begin + length)).first;
+	}
+	std::vector<int>& entries = row->second;
+	entries.insert(std::upper_bound(entries.begin(), entries.end(), target), target);
+	if (entries.size() > 1){
+		return;
+	}
+	// the row was empty before, source is a new non-empty row of the relation
+	auto sources = delta->sources.find(DeltaCSR::sourcesKey(relation, inverse));
+	if (sources == delta->sources.end()){
+		int* begin;
+		int length;
+		getSources(relation, inverse, begin, length);
+		sources = delta->sources.emplace(DeltaCSR::sourcesKey(relation, inverse), std::vector<int>(begin, begin + length)).first;
+	}
+	std::vector<int>& rows = sources->second;
+	rows.insert(std::upper_bound(rows.begin(), rows.end(), source), source);
+}
+
+void TripleStorage::freezeDelta(){
+	if (frozen){
+		throw std::runtime_error("A compaction of the data is already running.");
+	}
+	if (!delta){
+		return;
+	}
+	frozen = std::move(delta);
+	frozen->numNodes = index->getNodeSize();
+	frozen->numRelations = index->getRelSize();
+}
+
+std::unique_ptr<RelationalCSR> TripleStorage::buildCompacted(){
+	if (!frozen){
+		return nullptr;
+	}
+	TripleSet triples;
+	rcsr->getTriples(triples);
+	triples.insert(triples.end(), frozen->triples.begin(), frozen->triples.end());
+	return RelationalCSR::build(frozen->numRelations, frozen->numNodes, triples, compressed);
+}
+
+// the delta that was added in the meantime stays on top, its rows are complete already
+// the degrees do not change, so do the tie ranks
+void TripleStorage::swapCompacted(std::unique_ptr<RelationalCSR> compacted){
+	if (!compacted){
+		return;
+	}
+	setCSR(std::move(compacted));
+	frozen.reset();
+	layered = (bool) delta;
+	// the new CSR owns its arrays
+	mappedFile.reset();
+}
+
+// the compacted CSR has the same triples, it does not need a new version
+uint64_t TripleStorage::getVersion(){
+	return version;
+}
+
+void TripleStorage::newVersion(){
+	version = nextVersion.fetch_add(1);
+}
+
+bool TripleStorage::isCompacting(){
+	return (bool) frozen;
+}
+
+int TripleStorage::getDeltaSize(){
+	return delta ? delta->triples.size() : 0;
+}
+
+void TripleStorage::write(std::ostream& out){
+	if (!rcsr || !pending.empty() || layered){
+		throw std::runtime_error("The CSR needs to be loaded before a snapshot can be written.");
+	}
+	snapshot::writeValue<int64_t>(out, size);
+	rcsr->write(out);
+}
+
+void TripleStorage::read(snapshot::Reader& reader, std::shared_ptr<util::MappedFile> file){
+	size = reader.readValue<int64_t>();
+	setCSR(RelationalCSR::read(index->getRelSize(), index->getNodeSize(), reader));
+	mappedFile = file;
+	resetTieRanks();
+	newVersion();
 }
 
 void TripleStorage::add(std::string head, std::string relation, std::string tail) {
 	//Get ids
-	index->addNode(head);
-	index->addNode(tail);
-	index->addRelation(relation);
+	int headNodeId = index->addNode(head);
+	int tailNodeId = index->addNode(tail);
+	int relId = index->addRelation(relation);
 
-	int headNodeId = index->getIdOfNodestring(head);
-	int relId = index->getIdOfRelationstring(relation);
-	int tailNodeId = index->getIdOfNodestring(tail);
-
-	relHeadToTails[relId][headNodeId].insert(tailNodeId);
-	relTailToHeads[relId][tailNodeId].insert(headNodeId);
+	pending.push_back({headNodeId, relId, tailNodeId});
 
 	size += 1;
 	
@@ -116,82 +232,128 @@ void TripleStorage::addIdx(int head, int relation, int tail) {
 	index->getStringOfNodeId(tail);
 	index->getStringOfRelId(relation);
 
-	relHeadToTails[relation][head].insert(tail);
-	relTailToHeads[relation][tail].insert(head);
+	pending.push_back({head, relation, tail});
 
 	size += 1;
 	
 }
 
 
-Nodes* TripleStorage::getTforHR(int head, int relation){
-	auto it_rel = relHeadToTails.find(relation);
-	if (it_rel!=relHeadToTails.end()){
-		auto it_head = (it_rel->second).find(head);
-		if (it_head!=(it_rel->second).end()){
-			return &(it_head->second);
+bool TripleStorage::getLayerRow(int relation, bool inverse, int node, int*& begin, int& length){
+	return (delta && delta->getRow(relation, inverse, node, begin, length))
+		|| (frozen && frozen->getRow(relation, inverse, node, begin, length));
+}
+
+void TripleStorage::getRow(int relation, bool inverse, int node, int*& begin, int& length){
+	if (!layered || !getLayerRow(relation, inverse, node, begin, length)){
+		if (narrowCSR){
+			inverse ? narrowCSR->getHforTREfficient(node, relation, begin, length) : narrowCSR->getTforHREfficient(node, relation, begin, length);
+		} else {
+			inverse ? wideCSR->getHforTREfficient(node, relation, begin, length) : wideCSR->getTforHREfficient(node, relation, begin, length);
 		}
 	}
-	return nullptr;
 }
-Nodes* TripleStorage::getHforTR(int tail, int relation){
-	auto it_rel = relTailToHeads.find(relation);
-	if (it_rel!=relTailToHeads.end()){
-		auto it_head = (it_rel->second).find(tail);
-		if (it_head!=(it_rel->second).end()){
-			return &(it_head->second);
+
+void TripleStorage::setCSR(std::unique_ptr<RelationalCSR> csr){
+	rcsr = std::move(csr);
+	narrowCSR = dynamic_cast<RelationalCSRImpl<uint32_t>*>(rcsr.get());
+	wideCSR = dynamic_cast<RelationalCSRImpl<uint64_t>*>(rcsr.get());
+}
+
+void TripleStorage::getSources(int relation, bool inverse, int*& begin, int& length){
+	if (layered){
+		if ((delta && delta->getSources(relation, inverse, begin, length))
+			|| (frozen && frozen->getSources(relation, inverse, begin, length))){
+			return;
 		}
 	}
-	return nullptr;
+	inverse ? rcsr->getTails(relation, begin, length) : rcsr->getHeads(relation, begin, length);
 }
 
+const TripleSet& TripleStorage::getPending(){
+	return pending;
+}
 
-void TripleStorage::getTforHR(int head, int relation, int*& begin, int& length){
-	rcsr->getTforHREfficient(head, relation, begin, length);
+void TripleStorage::relabelPending(const std::vector<int>& newIds){
+	for (Triple& triple : pending){
+		triple[0] = newIds[triple[0]];
+		triple[2] = newIds[triple[2]];
+	}
+}
 
+void TripleStorage::getTforHR(int head, int relation, int*& begin, int& length){
+	getRow(relation, false, head, begin, length);
 }
+
 void TripleStorage::getHforTR(int tail, int relation, int*& begin, int& length){
-	rcsr->getHforTREfficient(tail, relation, begin, length);
+	getRow(relation, true, tail, begin, length);
+}
+
+void TripleStorage::getHeads(int relation, int*& begin, int& length){
+	getSources(relation, false, begin, length);
+}
 
+void TripleStorage::getTails(int relation, int*& begin, int& length){
+	getSources(relation, true, begin, length);
 }
 
 Index* TripleStorage::getIndex(){
 	return index.get();
 }
 
+// a compressed row of the CSR is not decoded for the check
 bool TripleStorage::contains(int head, int relation, int tail){
-	auto it = relHeadToTails.find(relation);
-	if (it!=relHeadToTails.end()){
-		NodeToNodes& HtoT = it->second;
-		auto _it = HtoT.find(head);
-		if (_it != HtoT.end()){
-        	if((_it->second).count(tail)>0){
-                 return true;
-        	}
-	 	}
+	int* begin;
+	int length;
+	if (layered && getLayerRow(relation, false, head, begin, length)){
+		return std::binary_search(begin, begin + length, tail);
 	}
-	return false;
+	return narrowCSR ? narrowCSR->contains(head, relation, tail) : wideCSR->contains(head, relation, tail);
 }
 
+void TripleStorage::resetTieRanks(){
+	// ties are broken by the ids the user sees such that the results do not depend on the entity order
+	tieRanks.resize(index->getNodeSize());
+	for (int i=0; i<tieRanks.size(); i++){
+		tieRanks[i] = index->toExternalNode(i);
+	}
+	tieRanksByFreq = false;
+}
+
+// the degrees are part of the CSR (and the delta), only the order has to be computed
+// such that the sort comparators compare a single int
 void TripleStorage::calcEntityFreq(){
-	for (int r=0; r<index->getRelSize(); r++){
-		for (int i=0; i<index->getNodeSize(); i++){
-			int* beginH;
-			int lengthH;
-			getHforTR(i, r, beginH, lengthH);
-			entityFrequencies[i] += lengthH;
-			int* beginT;
-			int lengthT;
-			getTforHR(i, r, beginT, lengthT);
-			entityFrequencies[i] += lengthT;
-		}
+	if (tieRanksByFreq){
+		return;
+	}
+	std::vector<int> entities(tieRanks.size());
+	std::vector<int> freqs(tieRanks.size());
+	std::iota(entities.begin(), entities.end(), 0);
+	for (int i=0; i<freqs.size(); i++){
+		freqs[i] = getFreq(i);
 	}
+	// tieRanks holds the external ids here
+	std::sort(entities.begin(), entities.end(), [this, &freqs](int a, int b){
+		return freqs[a] != freqs[b] ? freqs[a] > freqs[b] : tieRanks[a] < tieRanks[b];
+	});
+	for (int i=0; i<entities.size(); i++){
+		tieRanks[entities[i]] = i;
+	}
+	tieRanksByFreq = true;
 }
 
 int TripleStorage::getFreq(int ent){
-	return entityFrequencies[ent];
+	int degree;
+	if (layered && ((delta && delta->getDegree(ent, degree)) || (frozen && frozen->getDegree(ent, degree)))){
+		return degree;
+	}
+	return rcsr->getDegree(ent);
+}
+
+int TripleStorage::getTieRank(int ent){
+	return tieRanks[ent];
 }
 
-int TripleStorage::getSize(){
+int64_t TripleStorage::getSize(){
 	return size;
 }
@@ -9,9 +9,12 @@
 #include "Types.h"
 #include "Util.hpp"
 #include "RelationalCSR.hpp"
+#include "DeltaCSR.hpp"
+#include "Snapshot.hpp"
 #include <string>
 #include <array>
 #include <vector>
+#include <atomic>
 
 class TripleStorage
 {
@@ -19,39 +22,92 @@ public:
 	TripleStorage(std::shared_ptr<Index> index);
 	std::unique_ptr<RelationalCSR> rcsr;
 
-	RelNodeToNodes& getRelHeadToTails();
-	RelNodeToNodes& getRelTailToHeads();
+	// the file is parsed in parallel with numThreads (see setNumThreads)
 	void read(std::string filepath, bool loadCSR=true);
 	void read(std::vector<std::array<int, 3>> triples, bool loadCSR=true);
 	void read(std::vector<std::array<std::string, 3>> triples, bool loadCSR=true);
 	void loadCSR();
+	// moves the added triples into a delta layer on top of the CSR without rebuilding it
+	// a long lived storage can take updates like this, the delta is merged into the CSR by a compaction
+	void loadDelta();
+	// compaction in three steps, only buildCompacted() can run concurrently to queries and loadDelta()
+	// as it only reads the frozen delta and the CSR; the other steps need exclusive access
+	void freezeDelta();
+	std::unique_ptr<RelationalCSR> buildCompacted();
+	void swapCompacted(std::unique_ptr<RelationalCSR> compacted);
+	// true if there is a frozen delta whose compacted CSR was not swapped in yet
+	bool isCompacting();
+	// number of (new) triples in the delta that is not frozen
+	int getDeltaSize();
+	// snapshot of the CSR (see Snapshot.hpp), the index is written separately
+	void write(std::ostream& out);
+	// uses the CSR arrays of the mapped file in place, file is kept alive by this storage
+	void read(snapshot::Reader& reader, std::shared_ptr<util::MappedFile> file);
 	void add(std::string head, std::string relation, std::string tail);
 	void add(int head, int relation, int tail);
 	void addIdx(int head, int relation, int tail);
+	// triples that were added but are not in the CSR yet
+	const TripleSet& getPending();
+	// entity e of the pending triples gets the id newIds[e] (see Index::permuteNodes())
+	void relabelPending(const std::vector<int>& newIds);
 	// return true if the triple exists in the data, otherwise false
 	bool contains(int head, int relation, int tail);
 
-	Nodes* getTforHR(int head, int relation);
-	Nodes* getHforTR(int tail, int relation);
 	void getTforHR(int head, int relation, int*& begin, int& length);
 	void getHforTR(int tail, int relation, int*& begin, int& length);
+	// all heads (tails) that occur with relation, ascending
+	void getHeads(int relation, int*& begin, int& length);
+	void getTails(int relation, int*& begin, int& length);
 	Index* getIndex();
 	
 	RelationalCSR* getCSR();
+	void setNumThreads(int num);
+	// the CSR is built with compressed rows on the next loadCSR() (see RowCodec.hpp)
+	void setCompressed(bool compressed);
+	// precomputes the tie break key of frequency tie handling (once per CSR)
 	void calcEntityFreq();
+	// degree of the entity
 	int getFreq(int entity);
-	int getSize();
+	// entities with a lower key rank before the others for equal scores:
+	// higher frequency then lower (external) id after calcEntityFreq(), the id before
+	int getTieRank(int entity);
+	int64_t getSize();
+	// changes whenever the queried triples change, a version is never used by two storages
+	// (precomputed results of rules are checked against it, see RuleD::buildBodyIndex())
+	uint64_t getVersion();
 	
 
 protected:
 
 private:
 	// num triples
-	int size=0;
+	int64_t size=0;
 	std::shared_ptr<Index> index;
-	RelNodeToNodes relHeadToTails;
-	RelNodeToNodes relTailToHeads;
-	std::unordered_map<int, int> entityFrequencies;
+	std::shared_ptr<util::MappedFile> mappedFile;
+	// threads for reading files
+	int numThreads = 1;
+	bool compressed = false;
+	// triples added since the last loadCSR(), they are moved into the CSR on loadCSR()
+	TripleSet pending;
+	// lookups check delta, then frozen, then rcsr; layered is false if both are empty
+	std::unique_ptr<DeltaCSR> delta;
+	std::unique_ptr<DeltaCSR> frozen;
+	bool layered = false;
+	bool getLayerRow(int relation, bool inverse, int node, int*& begin, int& length);
+	void getRow(int relation, bool inverse, int node, int*& begin, int& length);
+	void getSources(int relation, bool inverse, int*& begin, int& length);
+	// rcsr as its concrete type (one of them is set), the row lookups call it directly instead of
+	// going through the virtual interface; the width of the offsets is only checked once in setCSR()
+	RelationalCSRImpl<uint32_t>* narrowCSR = nullptr;
+	RelationalCSRImpl<uint64_t>* wideCSR = nullptr;
+	void setCSR(std::unique_ptr<RelationalCSR> csr);
+	void insertIntoDelta(int source, int relation, bool inverse, int target);
+	std::vector<int> tieRanks;
+	bool tieRanksByFreq = false;
+	void resetTieRanks();
+	uint64_t version = 0;
+	static std::atomic<uint64_t> nextVersion;
+	void newVersion();
 };
 
 #endif // TRIPLESTORAGE_H
\ No newline at end of file
@@ -19,6 +19,17 @@
 #include <iostream>
 #include <time.h>
 #include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace util{
 	inline std::vector<std::string> split(const std::string& str, char delim = ' ') {
@@ -239,7 +250,66 @@ namespace util{
 			throw std::invalid_argument("Tried to parse a string into a bool but did not understand the string");
 		}
 	}
-}
-#endif // UTIL_H
 
+	// read-only view of a whole file, mmapped where available
+	// the page cache is shared between all processes that map the same file
+	class MappedFile {
+	public:
+		MappedFile(std::string path) {
+		#ifdef _WIN32
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open()) {
+				throw std::runtime_error("Unable to open file " + path);
+			}
+			buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			begin = buffer.data();
+			length = buffer.size();
+		#else
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("Unable to open file " + path);
+			}
+			struct stat st;
+			if (fstat(fd, &st) != 0) {
+				close(fd);
+				throw std::runtime_error("Unable to stat file " + path);
+			}
+			length = st.st_size;
+			// mapping an empty file fails, there is nothing to view anyways
+			if (length > 0) {
+				void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+				if (mapped == MAP_FAILED) {
+					close(fd);
+					throw std::runtime_error("Unable to map file " + path);
+				}
+				begin = static_cast<const char*>(mapped);
+			}
+			close(fd);
+		#endif
+		}
+
+		virtual ~MappedFile() {
+		#ifndef _WIN32
+			if (length > 0) {
+				munmap(const_cast<char*>(begin), length);
+			}
+		#endif
+		}
 
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data() const { return begin; }
+		size_t size() const { return length; }
+
+	protected:
+		// for mappings of something else than a file (see SharedMemory.h), begin is unmapped on destruction
+		MappedFile() {}
+		const char* begin = nullptr;
+		size_t length = 0;
+	#ifdef _WIN32
+		std::vector<char> buffer;
+	#endif
+	};
+}
+#endif // UTIL_H
@@ -14,6 +14,10 @@
 #include "../core/RuleStorage.h"
 #include "../core/Types.h"
 #include "../core/Rule.h"
+#include "../core/RuleTrie.h"
+#include "../core/ClosingSetCache.h"
+#include "../core/RuleBlocks.h"
+#include "../core/QueryArena.h"
 #include "../core/Combo.h"
 #include "../core/Globals.h"
 
@@ -46,12 +50,16 @@ void ApplicationHandler::calculateTripleScores(std::vector<Triple> triples, Trip
         // we dont need to set num_top_rules as the stopping is handled outside; there is only one "candidate"
         tripleResults.setAggrFunc(rank_aggrFunc);
         RuleGroundings ruleGroundings;   
+        // reused by all triples of the thread
+        std::vector<std::pair<int, double>> sortedCandScores;
         #pragma omp for schedule(dynamic)
         for (int i=0; i<triples.size(); i++){
            
             if (verbose && i%1000==0 && i>0){
                 std::cout<<"Scored "<<(i/1000) * 1000<<" triples..."<<std::endl;
             }
+            // the transient allocations of scoring this triple
+            QueryArena::Scope arenaScope;
             Triple triple = triples[i];
             int head = triple[0];
             int rel = triple[1];
@@ -84,8 +92,8 @@ void ApplicationHandler::calculateTripleScores(std::vector<Triple> triples, Trip
             }
 
             // we actually only have on candidate but we still need to process
-            std::unordered_map<int, double>& candScores = tripleResults.getCandScores();
-            std::vector<std::pair<int, double>> sortedCandScores(candScores.begin(), candScores.end());
+            // the scores are read from the candidate table, no map is built
+            sortedCandScores.clear();
             // tie handling, final processing, sorting (no query context for triple scoring)
             (this->*sortAndProcess)(sortedCandScores, tripleResults, train, rules, -1, -1, true, nullptr, 0);
 
@@ -108,16 +116,6 @@ void ApplicationHandler::calculateTripleScores(std::vector<Triple> triples, Trip
 }
 
 void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStorage& train, RuleStorage& rules, TripleStorage& addFilter, bool dirIsTail){
-    // define rule prediction function depending on direction
-    typedef bool (Rule::*RulePredFunc)(int, TripleStorage&, QueryResults&, ManySet);
-    RulePredFunc predictHeadOrTail;
-
-    if(dirIsTail){
-        predictHeadOrTail = &Rule::predictTailQuery;
-    }else{
-        predictHeadOrTail = &Rule::predictHeadQuery;
-    }
-
     typedef void (ApplicationHandler::*SortAndProcessPtr)(std::vector<std::pair<int,double>>&, QueryResults&, TripleStorage&, RuleStorage&, int, int, bool, const int*, int);
     SortAndProcessPtr sortAndProcess = nullptr;
 
@@ -142,7 +140,7 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
     int numNodes = train.getIndex()->getNodeSize();
     int numRel = train.getIndex()->getRelSize();
     // size is num triples not queries 
-    int chunk = std::min(10000, std::max(1000, (target.getSize())/50));
+    int chunk = std::min<int64_t>(10000, std::max<int64_t>(1000, (target.getSize())/50));
 
 
     std::vector<std::tuple<int,int,int>> tasks;
@@ -157,6 +155,29 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
                 }
         }
     }
+    // the rules of a relation are applied by type (see RuleBlocks)
+    // B rules of a relation that share their first body atoms search them once per query
+    std::vector<std::unique_ptr<RuleBlocks>> blocks(numRel);
+    std::vector<std::unique_ptr<RuleTrie>> tries(numRel);
+    for (auto& task : tasks){
+        int rel = std::get<0>(task);
+        if (!tries[rel]){
+            blocks[rel] = std::make_unique<RuleBlocks>(rules.getRelRules(rel));
+            tries[rel] = std::make_unique<RuleTrie>(rules.getRelRules(rel), dirIsTail);
+        }
+    }
+
+    // the order of rules is not the order of the scores when combos are used
+    bool certifiedStop = rank_certifiedStop && rank_aggrFunc=="maxplus" && !rules.hasCombos();
+    if (verbose && rank_certifiedStop && !certifiedStop){
+        std::cout<<"certified_stop needs maxplus without combos, using disc_at_least and hard_stop_at instead"<<std::endl;
+    }
+    // certification is checked with growing intervals as its costs grow with the score lists
+    const int maxCheckInterval = 32;
+
+    // candidates of rules that do not depend on the query entity are shared by the queries
+    ClosingSetCache cache(rules.getRules().size(), rank_cacheSizeMB < 0 ? -1 : (int64_t) (rank_cacheSizeMB * (1 << 20)), num_thr);
+
     int ctr=0;
     #pragma omp parallel num_threads(num_thr)
     {
@@ -164,9 +185,16 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
         qResults.setPerformAggregation(performAggregation);
         qResults.setAggrFunc(rank_aggrFunc);
         qResults.setNumTopRules(score_numTopRules);
-        ManySet filter;
+        FilterSet filter(numNodes);
+        std::vector<std::unique_ptr<RuleTrie::Frontiers>> frontiers(numRel);
+        std::vector<int> uncachedCands;
+        int thread = omp_get_thread_num();
         #pragma omp for schedule(dynamic)
         for (int i=0; i<tasks.size(); i++){
+            // the train filter row may be decoded from a compressed CSR, it is valid for this query
+            RowScratch::Scope scope;
+            // all other transient allocations of the query are released with the task
+            QueryArena::Scope arenaScope;
             int rel = std::get<0>(tasks[i]);
             int source = std::get<1>(tasks[i]);
             int length = std::get<2>(tasks[i]);
@@ -182,29 +210,55 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
             }else if (verbose && ctr%chunk==0){
                 std::cout<<"Calculated "<< (ctr/chunk) * chunk <<" head queries..."<<std::endl;
             }
-            auto& relRules = rules.getRelRules(rel);
+            const RuleBlocks& relRules = *blocks[rel];
              // filtering for train and additionalFilter
             if (rank_filterWtrain){
-                Nodes* trainFilter = nullptr;
-                trainFilter = (!dirIsTail) ? train.getHforTR(source, rel) : train.getTforHR(source, rel);
-                if (trainFilter){
-                    filter.addSet(trainFilter);
-                }   
-                        
+                int* trainFilter;
+                int trainLength;
+                (!dirIsTail) ? train.getHforTR(source, rel, trainFilter, trainLength) : train.getTforHR(source, rel, trainFilter, trainLength);
+                filter.addSet(trainFilter, trainLength);
             }
             // always filter with additionalFilter (can be empty)
-            Nodes* naddFilter = nullptr;
-            naddFilter = (!dirIsTail) ? addFilter.getHforTR(source, rel) : addFilter.getTforHR(source, rel);
-            if (naddFilter){
-                filter.addSet(naddFilter);
+            int* naddFilter;
+            int naddLength;
+            (!dirIsTail) ? addFilter.getHforTR(source, rel, naddFilter, naddLength) : addFilter.getTforHR(source, rel, naddFilter, naddLength);
+            filter.addSet(naddFilter, naddLength);
+            RuleTrie& trie = *tries[rel];
+            if (!trie.empty()){
+                if (!frontiers[rel]){
+                    frontiers[rel] = std::make_unique<RuleTrie::Frontiers>(trie);
+                }
+                frontiers[rel]->clear();
             }
-            // perform rule application
-            int ctr = 0;
+            // perform rule application, ctr is the position of the rule in the blocks and the trie
             int currSize = 0;
-            for (Rule* rule : relRules){
-                ctr += 1;
-                (rule->*predictHeadOrTail)(source, train, qResults, filter);
+            int nextCheck = 0;
+            int checkInterval = 1;
+            int numSkipped = 0;
+            cache.beginQuery(thread);
+            for (int ctr=0; ctr<relRules.size(); ctr++){
+                if (trie.contains(ctr)){
+                    trie.predict(ctr, source, train, qResults, filter, *frontiers[rel]);
+                }else if (cache.enabled() && relRules.usesQueryIndependentCands(ctr, source, dirIsTail)){
+                    Rule* rule = relRules.rule(ctr);
+                    const std::vector<int>& cands = cache.get(rule, train, dirIsTail, i, uncachedCands);
+                    rule->predictQueryWithCands(source, cands, qResults, filter, dirIsTail);
+                }else{
+                    relRules.predict(ctr, dirIsTail, source, train, qResults, filter);
+                }
                 currSize = qResults.size();
+                if (certifiedStop){
+                    // all following rules have at most the confidence of the next one
+                    if (currSize>=adapted_topk && ctr+1<relRules.size() && ctr>=nextCheck){
+                        if (qResults.checkCertifiedTopK(adapted_topk, relRules.rule(ctr+1)->getConfidence())){
+                            numSkipped = relRules.size() - ctr - 1;
+                            break;
+                        }
+                        checkInterval = std::min(2*checkInterval, maxCheckInterval);
+                        nextCheck = ctr + checkInterval;
+                    }
+                    continue;
+                }
                 if (rank_numPreselect>0 && currSize>=rank_numPreselect){
                     break;
                 }
@@ -223,6 +277,8 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
                     }
                  }
             }
+            // the cached sets are not used anymore by this query
+            cache.endQuery(thread);
 
             std::vector<std::pair<int, double>> sortedCandScores;
             // tie handling, final processing, sorting
@@ -237,6 +293,10 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
 
             #pragma omp critical
             {   
+                if (numSkipped>0){
+                    rank_numSkippedRules += numSkipped;
+                    rank_numCertifiedStops += 1;
+                }
                 if (saveCandidateRules){
                     // TODO when needed could prevent copy here by using shared pointer
                     if (dirIsTail){
@@ -247,40 +307,61 @@ void ApplicationHandler::calculateQueryResults(TripleStorage& target, TripleStor
                 }
                 if (performAggregation){
                         auto& writeResults = (dirIsTail) ? tailQcandsConfs : headQcandsConfs;
-                        writeResults[rel][source] = sortedCandScores;
+                        writeResults[rel][source] = std::move(sortedCandScores);
                 }
             }
             qResults.clear();
             filter.clear();
         } 
     } //pragma
+    if (verbose && certifiedStop){
+        std::cout<<"Certified stop: "<<rank_numCertifiedStops<<" queries stopped early, "<<rank_numSkippedRules<<" rules skipped so far"<<std::endl;
+    }
+}
+
+namespace {
+    // orders the first k elements, the others follow in any order; k=-1 orders all
+    template<class It, class Compare>
+    void sortTopK(It begin, It end, int k, Compare comp){
+        if (k < 0 || k >= end - begin){
+            std::sort(begin, end, comp);
+            return;
+        }
+        std::nth_element(begin, begin + k, end, comp);
+        std::sort(begin, begin + k, comp);
+    }
+}
+
+// writeRanking() skips the true answers of the other queries, so it needs topk + num_true_answers candidates
+int ApplicationHandler::numToOrder(int numGroundTruth){
+    return (rank_fullRanking || saveCandidateRules) ? -1 : rank_topk + numGroundTruth;
 }
 
 void ApplicationHandler::sortAndProcessNoisy(std::vector<std::pair<int,double>>& candScoresToSort, QueryResults& qResults, TripleStorage& data, RuleStorage& rules, int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth){
     // noisyor scoring is already performed in QueryResults
 
-   std::unordered_map<int, double>& candScores = qResults.getCandScores();
-   candScoresToSort.assign(candScores.begin(), candScores.end()); 
+   qResults.getCandScores(candScoresToSort);
+   int numOrdered = numToOrder(numGroundTruth);
 
    if (rank_tie_handling=="random"){
-     std::sort(
+     sortTopK(
         candScoresToSort.begin(),
-        candScoresToSort.end(), 
+        candScoresToSort.end(),
+        numOrdered,
         [](const std::pair<int, double>& a, const std::pair<int, double>& b) {
             return a.second > b.second;
         }
      );
    }else if (rank_tie_handling=="frequency"){
-      std::sort(
+      sortTopK(
         candScoresToSort.begin(),
-        candScoresToSort.end(), 
+        candScoresToSort.end(),
+        numOrdered,
         [&data](const std::pair<int, double>& a, const std::pair<int, double>& b) {
             if (a.second!=b.second){
                 return a.second > b.second;
-            }else if(data.getFreq(a.first) != data.getFreq(b.first)) {
-                return data.getFreq(a.first) > data.getFreq(b.first);
             }else{
-                return a.first<b.first;
+                return data.getTieRank(a.first) < data.getTieRank(b.first);
             }
         }
       );
@@ -295,7 +376,7 @@ for (auto& pair: candScoresToSort){
 }
 
 void ApplicationHandler::sortAndProcessMax(std::vector<std::pair<int,double>>& candScoresToSort, QueryResults& qResults, TripleStorage& data, RuleStorage& rules, int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth){
-    scoreMaxPlus(qResults.getCandRules(), candScoresToSort, data, rules, queryRel, querySource, queryDirIsTail, groundTruthTargets, numGroundTruth);
+    scoreMaxPlus(qResults, candScoresToSort, data, rules, queryRel, querySource, queryDirIsTail, groundTruthTargets, numGroundTruth);
 }
 
 // currently not used in the ranking process
@@ -306,6 +387,7 @@ void ApplicationHandler::aggregateQueryResults(std::string direction, TripleStor
             int relation = queries.first;
             std::unordered_map<int, NodeToPredRules>& srcToCand = queries.second;
             for (auto& query: srcToCand){
+                QueryArena::Scope arenaScope;
                 int source = query.first; 
                 if (rank_aggrFunc=="maxplus"){
                     scoreMaxPlus(query.second, writeResults[relation][source], train, rules);
@@ -333,20 +415,24 @@ void ApplicationHandler::makeRanking(TripleStorage& target, TripleStorage& train
 // query results must have been calculated before and aggregated
 void ApplicationHandler::writeRanking(TripleStorage& target, std::string filepath){
     Index* index = target.getIndex();
-    RelNodeToNodes& data = target.getRelTailToHeads();
     std::ofstream file(filepath);
     if (!file.is_open()) {
         throw  std::runtime_error("Failed to create file. Please check if the paths are correct: " + filepath );
     }
-    for (auto& relQueries: data){
-        int relation = relQueries.first;
-        for (auto& srcTocands: relQueries.second){
-            int tail = srcTocands.first;
+    for (int relation=0; relation<index->getRelSize(); relation++){
+        int* tails;
+        int numTails;
+        target.getTails(relation, tails, numTails);
+        for (int t=0; t<numTails; t++){
+            int tail = tails[t];
             // true heads
-            Nodes& trueHeads = srcTocands.second;
+            int* trueHeads;
+            int numTrueHeads;
+            target.getHforTR(tail, relation, trueHeads, numTrueHeads);
             // we use this direction to iterate over all triples
             // head relation tail is one triple of the target set
-            for (int head: trueHeads){
+            for (int h=0; h<numTrueHeads; h++){
+                int head = trueHeads[h];
                 if (file.is_open()){
                     file<<index->getStringOfNodeId(head)<<" "<<index->getStringOfRelId(relation)<<" "<<index->getStringOfNodeId(tail)<<std::endl;
                     file<<"Heads: ";
@@ -360,7 +446,7 @@ void ApplicationHandler::writeRanking(TripleStorage& target, std::string filepat
                         // filter with target
                         // current predicted head is excluded if its the true answer to some other query
                         if (rank_filterWtarget && !(predHead==head)){
-                            if (!(trueHeads.find(predHead)==trueHeads.end())){
+                            if (std::binary_search(trueHeads, trueHeads + numTrueHeads, predHead)){
                                 continue;
                             }
                         }
@@ -373,7 +459,9 @@ void ApplicationHandler::writeRanking(TripleStorage& target, std::string filepat
                     // write tail ranking
                     file<<"\nTails: ";
                     //true tails for filtering
-                    Nodes& trueTails = target.getRelHeadToTails()[relation][head];
+                    int* trueTails;
+                    int numTrueTails;
+                    target.getTforHR(head, relation, trueTails, numTrueTails);
                     CandidateConfs& resultsTail = tailQcandsConfs[relation][head];
                     numWritten = 0;
                     for (int i=0; i<resultsTail.size(); i++){
@@ -381,7 +469,7 @@ void ApplicationHandler::writeRanking(TripleStorage& target, std::string filepat
                         int predTail = pair.first;
                         double score = pair.second;
                         if (rank_filterWtarget && !(predTail==tail)){
-                            if (!(trueTails.find(predTail)==trueTails.end())){
+                            if (std::binary_search(trueTails, trueTails + numTrueTails, predTail)){
                                 continue;
                             }
                         }
@@ -422,7 +510,7 @@ void ApplicationHandler::writeRules(TripleStorage& target, std::string filepath,
         std::string relationStr = strings ? "\"" + index->getStringOfRelId(relation) + "\"" : std::to_string(relation);
         for (auto& srcQueries: relQueries.second){
             int src = srcQueries.first;
-            std::string srcStr = strings ? "\"" + index->getStringOfNodeId(src) + "\"" : std::to_string(src);
+            std::string srcStr = strings ? "\"" + index->getStringOfNodeId(src) + "\"" : std::to_string(index->toExternalNode(src));
         
             // Collect answers and rules
             std::string answers = "";
@@ -431,7 +519,7 @@ void ApplicationHandler::writeRules(TripleStorage& target, std::string filepath,
             auto itr = srcQueries.second.begin();
             for(; itr != srcQueries.second.end(); itr++){
                 int to = itr->first;
-                std::string toStr = strings ? "\"" + index->getStringOfNodeId(to) + "\"" : std::to_string(to);
+                std::string toStr = strings ? "\"" + index->getStringOfNodeId(to) + "\"" : std::to_string(index->toExternalNode(to));
                 answers += toStr;
                 if (std::next(itr) != srcQueries.second.end()) {
                     answers += ",";
@@ -457,14 +545,93 @@ void ApplicationHandler::writeRules(TripleStorage& target, std::string filepath,
     std::cout<<"Rules file written to:  " + filepath <<std::endl; 
 }
 
+namespace {
+    // the rules of a candidate without copying them
+    struct RuleRange {
+        Rule* const* first;
+        Rule* const* last;
+        Rule* const* begin() const { return first; }
+        Rule* const* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        Rule* operator[](size_t i) const { return first[i]; }
+    };
+
+    // the candidates of a query as scoreMaxPlus reads them: the candidate table of QueryResults
+    struct TableCands {
+        QueryResults& results;
+        int size() { return results.size(); }
+        int cand(int i) { return results.getCandsOrdered()[i]; }
+        QueryResults::CandRules rules(int i) { return results.getRulesAt(i); }
+        // tracked while the rules are inserted, the rules are not read
+        double bestConf(int i) { return results.getBestRuleAt(i)->getConfidence(); }
+    };
+
+    // or the rules collected for a query (see aggregateQueryResults())
+    struct MapCands {
+        ArenaVector<std::pair<int, RuleRange>> entries;
+        MapCands(const NodeToPredRules& candToRules) {
+            entries.reserve(candToRules.size());
+            for (const auto& pair : candToRules) {
+                entries.push_back({pair.first, RuleRange{pair.second.data(), pair.second.data() + pair.second.size()}});
+            }
+        }
+        int size() { return entries.size(); }
+        int cand(int i) { return entries[i].first; }
+        RuleRange rules(int i) { return entries[i].second; }
+        double bestConf(int i) {
+            double best = 0.0;
+            for (Rule* rule : entries[i].second) {
+                best = std::max(best, rule->getConfidence());
+            }
+            return best;
+        }
+    };
+
+    // a candidate in scoreMaxPlus, its score list is stored in one buffer for all candidates
+    struct MaxPlusCand {
+        int cand;
+        int begin;
+        int length;
+        // the highest score decides most comparisons
+        double maxConf;
+        int tieRank;
+    };
+}
+
 void ApplicationHandler::scoreMaxPlus(
     const NodeToPredRules& candToRules, std::vector<std::pair<int, double>>& aggrCand, TripleStorage& train, RuleStorage& rules,
+    int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth
+     ){
+    MapCands cands(candToRules);
+    scoreMaxPlusCands(cands, aggrCand, train, rules, queryRel, querySource, queryDirIsTail, groundTruthTargets, numGroundTruth);
+}
+
+void ApplicationHandler::scoreMaxPlus(
+    QueryResults& qResults, std::vector<std::pair<int, double>>& aggrCand, TripleStorage& train, RuleStorage& rules,
+    int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth
+     ){
+    TableCands cands{qResults};
+    scoreMaxPlusCands(cands, aggrCand, train, rules, queryRel, querySource, queryDirIsTail, groundTruthTargets, numGroundTruth);
+}
+
+template<class Cands>
+void ApplicationHandler::scoreMaxPlusCands(
+    Cands& cands, std::vector<std::pair<int, double>>& aggrCand, TripleStorage& train, RuleStorage& rules,
     int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth
      ){
     
     // Pre-compute score lists for all candidates
-    std::unordered_map<int, std::vector<double>> candToScoreList;
-    std::unordered_map<int, std::vector<double>> candToScoreListBeforeCombo; // For comparison
+    // the temporary containers live in the arena of the current task (see QueryArena)
+    // the score lists of all candidates are stored after each other in scoreBuffer
+    ArenaVector<double> scoreBuffer;
+    ArenaVector<MaxPlusCand> candsToSort;
+    candsToSort.reserve(cands.size());
+    bool frequencyTies = (rank_tie_handling == "frequency");
+    if (!frequencyTies && rank_tie_handling != "random") {
+        throw std::runtime_error("Could not understand tie_handling_parameter in scoreMaxPlus.");
+    }
+    ArenaMap<int, ArenaVector<double>> candToScoreListBeforeCombo; // For comparison, only for debugging
     
     // Debug: Track first few queries for detailed analysis - ONLY thread 0
     static int queryCount = 0;
@@ -492,22 +659,38 @@ void ApplicationHandler::scoreMaxPlus(
         }
     }
 
-    for (const auto& pair : candToRules) {
-        int candidate = pair.first;
-        std::vector<Rule*> appliedRules = pair.second;
-        
-        std::vector<double> scoreList;
-        std::vector<double> scoreListBeforeCombo; // For comparison
+    // only the first numOrdered candidates are ordered; without combos the highest score of a candidate is the
+    // confidence of its best rule, a candidate whose best rule is below the numOrdered-th best of all candidates
+    // cannot get into the ordered part and its score list is cut after the first score
+    int numOrdered = shouldDebug ? -1 : numToOrder(numGroundTruth);
+    bool truncate = numOrdered > 0 && numOrdered < cands.size() && !rules.hasCombos();
+    ArenaVector<double> bestConfs;
+    double minConfOrdered = 0.0;
+    if (truncate) {
+        bestConfs.reserve(cands.size());
+        // a candidate that is cut touches none of its rules
+        for (int candIdx=0; candIdx<cands.size(); candIdx++) {
+            bestConfs.push_back(cands.bestConf(candIdx));
+        }
+        ArenaVector<double> kth(bestConfs.begin(), bestConfs.end());
+        std::nth_element(kth.begin(), kth.begin() + numOrdered - 1, kth.end(), std::greater<double>());
+        minConfOrdered = kth[numOrdered - 1];
+    }
+
+    // scores one candidate, appliedRules are its rules ordered by rank
+    auto scoreCandidate = [&](int candidate, const auto& appliedRules) {
+        ArenaVector<double> scoreList;
+        ArenaVector<double> scoreListBeforeCombo; // For comparison
+        scoreList.reserve(appliedRules.size());
 
-        // Step 1: Sort applied rules by confidence (descending)
-        std::sort(appliedRules.begin(), appliedRules.end(), 
-            [](Rule* a, Rule* b) { return a->getConfidence() > b->getConfidence(); });
-        bestRule = appliedRules.empty() ? nullptr : appliedRules[0];
+        bestRule = appliedRules.empty() ? nullptr : *appliedRules.begin();
         
         // Step 2: Build scoreList with single rule confidences (already sorted)
         for (Rule* rule : appliedRules) {
             scoreList.push_back(rule->getConfidence());
-            scoreListBeforeCombo.push_back(rule->getConfidence());
+            if (shouldDebug) {
+                scoreListBeforeCombo.push_back(rule->getConfidence());
+            }
         }
         
         double maxConfBefore = scoreList.empty() ? 0.0 : scoreList[0];
@@ -525,15 +708,15 @@ void ApplicationHandler::scoreMaxPlus(
         // Step 3: Find and add combo confidences if applicable
         bool foundCombo = false;
         Combo* bestCombo = nullptr;
-        std::vector<Rule*> comboMemberRules;
+        ArenaVector<Rule*> comboMemberRules;
         
         auto findCombo = [&](int topK = 1) {
             auto& ruleHashToCombos = rules.getRuleHashToCombos();
             int addedCombos = 0;
             
             // Build combo2count
-            std::unordered_map<Combo*, int> combo2count;
-            std::unordered_map<Combo*, std::vector<Rule*>> comboToRules; // Track which rules form the combo
+            ArenaMap<Combo*, int> combo2count;
+            ArenaMap<Combo*, ArenaVector<Rule*>> comboToRules; // Track which rules form the combo
             
             for (Rule* rule : appliedRules) {
                 size_t ruleHash = rule->getRuleHash();
@@ -564,8 +747,10 @@ void ApplicationHandler::scoreMaxPlus(
             findCombo(1);
         }
         
-        // Sort scoreList in descending order for comparison
-        std::sort(scoreList.begin(), scoreList.end(), std::greater<double>());
+        // Sort scoreList in descending order for comparison, without combos it is sorted already
+        if (foundCombo) {
+            std::sort(scoreList.begin(), scoreList.end(), std::greater<double>());
+        }
         
         double maxConfAfter = scoreList.empty() ? 0.0 : scoreList[0];
         bool maxConfChanged = (maxConfAfter != maxConfBefore);
@@ -614,17 +799,44 @@ void ApplicationHandler::scoreMaxPlus(
             std::cout << "  [NO COMBO FOUND]" << std::endl;
         }
         
-        candToScoreList[candidate] = std::move(scoreList);
-        candToScoreListBeforeCombo[candidate] = std::move(scoreListBeforeCombo);
+        candsToSort.push_back({
+            candidate, (int) scoreBuffer.size(), (int) scoreList.size(), scoreList.empty() ? 0.0 : scoreList[0],
+            frequencyTies ? train.getTieRank(candidate) : 0
+        });
+        scoreBuffer.insert(scoreBuffer.end(), scoreList.begin(), scoreList.end());
+        if (shouldDebug) {
+            candToScoreListBeforeCombo[candidate] = std::move(scoreListBeforeCombo);
+        }
+    };
+
+    // rules are predicted in rank order during rule application, then they are read in place
+    auto byRank = [](Rule* a, Rule* b) { return a->getRank() < b->getRank(); };
+    for (int candIdx=0; candIdx<cands.size(); candIdx++) {
+        int candidate = cands.cand(candIdx);
+        if (truncate && bestConfs[candIdx] < minConfOrdered) {
+            candsToSort.push_back({
+                candidate, (int) scoreBuffer.size(), 1, bestConfs[candIdx], frequencyTies ? train.getTieRank(candidate) : 0
+            });
+            scoreBuffer.push_back(bestConfs[candIdx]);
+            continue;
+        }
+        auto appliedRules = cands.rules(candIdx);
+        if (std::is_sorted(appliedRules.begin(), appliedRules.end(), byRank)) {
+            scoreCandidate(candidate, appliedRules);
+        } else {
+            // Step 1: Sort applied rules by confidence (descending)
+            ArenaVector<Rule*> sortedRules(appliedRules.begin(), appliedRules.end());
+            std::sort(sortedRules.begin(), sortedRules.end(), byRank);
+            scoreCandidate(candidate, RuleRange{sortedRules.data(), sortedRules.data() + sortedRules.size()});
+        }
     }
     
     if (shouldDebug) {
         std::cout << "\n[RANKING PHASE]" << std::endl;
-        std::cout << "  Sorting " << candToRules.size() << " candidates by lexicographic order..." << std::endl;
+        std::cout << "  Sorting " << cands.size() << " candidates by lexicographic order..." << std::endl;
     }
 
     // Now sort candidates using pre-computed score lists
-    std::vector<std::pair<int, std::vector<Rule*>>> candsToSort(candToRules.begin(), candToRules.end());
     
     // Store original order for comparison and find ground truth positions
     std::vector<int> originalOrder;
@@ -632,45 +844,33 @@ void ApplicationHandler::scoreMaxPlus(
     std::unordered_map<int, int> gtPositionsBefore;
     std::unordered_map<int, int> gtPositionsAfter;
 
-    auto sortLexicographic = [&train, &candToScoreList, this](
-        const std::pair<int, std::vector<Rule*>>& candA, 
-        const std::pair<int, std::vector<Rule*>>& candB) {
-        
-        const std::vector<double>& scoresA = candToScoreList.at(candA.first);
-        const std::vector<double>& scoresB = candToScoreList.at(candB.first);
+    auto sortLexicographic = [&scoreBuffer, frequencyTies](const MaxPlusCand& candA, const MaxPlusCand& candB) {
+        if (candA.maxConf != candB.maxConf) return candA.maxConf > candB.maxConf;
+
+        const double* scoresA = scoreBuffer.data() + candA.begin;
+        const double* scoresB = scoreBuffer.data() + candB.begin;
         
         // Compare score lists lexicographically
-        size_t minSize = std::min(scoresA.size(), scoresB.size());
-        for (size_t i = 0; i < minSize; i++) {
+        int minSize = std::min(candA.length, candB.length);
+        for (int i = 1; i < minSize; i++) {
             if (scoresA[i] > scoresB[i]) return true;
             if (scoresB[i] > scoresA[i]) return false;
         }
         
         // If all compared scores are equal, rank by number of scores
-        if (scoresA.size() > scoresB.size()) return true;
-        if (scoresB.size() > scoresA.size()) return false;
+        if (candA.length > candB.length) return true;
+        if (candB.length > candA.length) return false;
         
-        // Tie handling for exactly same scores
-        if (this->rank_tie_handling == "random") {
-            return false;
-        } else if (this->rank_tie_handling == "frequency") {
-            if (train.getFreq(candA.first) != train.getFreq(candB.first)) {
-                return train.getFreq(candA.first) > train.getFreq(candB.first);
-            } else {
-                return candA.first < candB.first;
-            }
-        } else {
-            throw std::runtime_error("Could not understand tie_handling_parameter in scoreMaxPlus.");
-        }
+        // Tie handling for exactly same scores, random keeps them as they are
+        return frequencyTies && candA.tieRank < candB.tieRank;
     };
 
 
     auto sortLexicographicBeforeCombo = [&train, &candToScoreListBeforeCombo, this](
-        const std::pair<int, std::vector<Rule*>>& candA, 
-        const std::pair<int, std::vector<Rule*>>& candB) {
+        const MaxPlusCand& candA, const MaxPlusCand& candB) {
         
-        const std::vector<double>& scoresA = candToScoreListBeforeCombo.at(candA.first);
-        const std::vector<double>& scoresB = candToScoreListBeforeCombo.at(candB.first);
+        const ArenaVector<double>& scoresA = candToScoreListBeforeCombo.at(candA.cand);
+        const ArenaVector<double>& scoresB = candToScoreListBeforeCombo.at(candB.cand);
         
         // Compare score lists lexicographically
         size_t minSize = std::min(scoresA.size(), scoresB.size());
@@ -687,11 +887,7 @@ void ApplicationHandler::scoreMaxPlus(
         if (this->rank_tie_handling == "random") {
             return false;
         } else if (this->rank_tie_handling == "frequency") {
-            if (train.getFreq(candA.first) != train.getFreq(candB.first)) {
-                return train.getFreq(candA.first) > train.getFreq(candB.first);
-            } else {
-                return candA.first < candB.first;
-            }
+            return train.getTieRank(candA.cand) < train.getTieRank(candB.cand);
         } else {
             throw std::runtime_error("Could not understand tie_handling_parameter in scoreMaxPlus.");
         }
@@ -701,7 +897,7 @@ void ApplicationHandler::scoreMaxPlus(
     if (shouldDebug) {
         std::sort(candsToSort.begin(), candsToSort.end(), sortLexicographicBeforeCombo);
         for (int i = 0; i < candsToSort.size(); i++) {
-            int candId = candsToSort[i].first;
+            int candId = candsToSort[i].cand;
             originalOrder.push_back(candId);
             candToorigRank[candId] = i; 
             // Check if this candidate is in ground truth
@@ -717,12 +913,12 @@ void ApplicationHandler::scoreMaxPlus(
     }
 
 
-    std::sort(candsToSort.begin(), candsToSort.end(), sortLexicographic);
+    sortTopK(candsToSort.begin(), candsToSort.end(), numOrdered, sortLexicographic);
     
     if (shouldDebug) {
         // Find ground truth positions after sorting
         for (int i = 0; i < candsToSort.size(); i++) {
-            int candId = candsToSort[i].first;
+            int candId = candsToSort[i].cand;
             if (gtPositionsBefore.count(candId) > 0) {
                 gtPositionsAfter[candId] = i + 1; // 1-indexed rank
             }
@@ -730,9 +926,8 @@ void ApplicationHandler::scoreMaxPlus(
         
         std::cout << "  Top 10 candidates after sorting:" << std::endl;
         for (int i = 0; i < std::min(10, (int)candsToSort.size()); i++) {
-            int candId = candsToSort[i].first;
-            const std::vector<double>& scores = candToScoreList.at(candId);
-            double maxConf = scores.empty() ? 0.0 : scores[0];
+            int candId = candsToSort[i].cand;
+            double maxConf = candsToSort[i].maxConf;
             
             // Check if order changed
             bool orderChanged = (i < originalOrder.size() && originalOrder[i] != candId);
@@ -742,7 +937,7 @@ void ApplicationHandler::scoreMaxPlus(
             int origRank = candToorigRank.at(candId) + 1;
             std::cout << "    Rank " << (i+1) << ": Candidate " << candId 
                       << ", MaxConf=" << maxConf << ", MaxConfBefore=" << candToScoreListBeforeCombo.at(candId).front() << ", origRank=" << origRank
-                      << ", NumScores=" << scores.size();
+                      << ", NumScores=" << candsToSort[i].length;
             if (orderChanged) {
                 std::cout << " [ORDER CHANGED]";
             }
@@ -778,14 +973,15 @@ void ApplicationHandler::scoreMaxPlus(
     }
     
     // Take sorted candidates and use their highest score
-    for (const auto& pair : candsToSort) {
-        const std::vector<double>& scores = candToScoreList.at(pair.first);
-        double maxConf = scores.empty() ? 0.0 : scores[0];
-        aggrCand.push_back(std::make_pair(pair.first, maxConf));
+    aggrCand.reserve(aggrCand.size() + candsToSort.size());
+    for (const auto& entry : candsToSort) {
+        aggrCand.push_back(std::make_pair(entry.cand, entry.maxConf));
     }
 }
 
 void ApplicationHandler::clearAll(){
+    rank_numSkippedRules = 0;
+    rank_numCertifiedStops = 0;
     headQcandsRules.clear();
     headQcandsConfs.clear();
     tailQcandsRules.clear();
@@ -877,4 +1073,27 @@ void ApplicationHandler::setNumThr(int num){
 
 void ApplicationHandler::setAdaptTopK(bool ind){
     adapt_topk = ind;
+}
+
+void ApplicationHandler::setCacheSizeMB(double num){
+    if (num<0 && num!=-1){
+        throw std::runtime_error("The cache size must be -1 (no limit), 0 (off) or positive.");
+    }
+    rank_cacheSizeMB = num;
+}
+
+void ApplicationHandler::setCertifiedStop(bool ind){
+    rank_certifiedStop = ind;
+}
+
+void ApplicationHandler::setFullRanking(bool ind){
+    rank_fullRanking = ind;
+}
+
+long long ApplicationHandler::getNumSkippedRules(){
+    return rank_numSkippedRules;
+}
+
+long long ApplicationHandler::getNumCertifiedStops(){
+    return rank_numCertifiedStops;
 }
\ No newline at end of file
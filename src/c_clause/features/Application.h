@@ -29,6 +29,8 @@ public:
     void aggregateQueryResults(std::string direction, TripleStorage& train, RuleStorage& rules);
     //aggregation functions
     void scoreMaxPlus(const NodeToPredRules& candToRules, std::vector<std::pair<int, double>>& aggregatedCand, TripleStorage& train, RuleStorage& rules, int queryRel=-1, int querySource=-1, bool queryDirIsTail=true, const int* groundTruthTargets=nullptr, int numGroundTruth=0);
+    // the same for the candidates of a query in qResults, their rules are read from the candidate table in place
+    void scoreMaxPlus(QueryResults& qResults, std::vector<std::pair<int, double>>& aggregatedCand, TripleStorage& train, RuleStorage& rules, int queryRel=-1, int querySource=-1, bool queryDirIsTail=true, const int* groundTruthTargets=nullptr, int numGroundTruth=0);
     // writes to e.g. this->headQueryResults[rel][head].aggrCand
     void makeRanking(TripleStorage& target, TripleStorage& train, RuleStorage& rules, TripleStorage& addFilter);
     void writeRanking(TripleStorage& target, std::string path);
@@ -57,6 +59,12 @@ public:
     void setScoreCollectGroundings(bool ind);
     bool getScoreCollectGroundings();
     void setAdaptTopK(bool ind);
+    void setCacheSizeMB(double num);
+    void setCertifiedStop(bool ind);
+    void setFullRanking(bool ind);
+    // rules that were not applied due to certified_stop and queries stopped by it since the last clearAll()
+    long long getNumSkippedRules();
+    long long getNumCertifiedStops();
     void setQueryTopK(int num) {
         queryTopK = num;
     }
@@ -94,6 +102,9 @@ private:
 
     void sortAndProcessNoisy(std::vector<std::pair<int,double>>& candScoresToSort, QueryResults& qResults, TripleStorage& data, RuleStorage& rules, int queryRel=-1, int querySource=-1, bool queryDirIsTail=true, const int* groundTruthTargets=nullptr, int numGroundTruth=0);
     void sortAndProcessMax(std::vector<std::pair<int,double>>& candScoresToSort, QueryResults& qResults, TripleStorage& data, RuleStorage& rules, int queryRel=-1, int querySource=-1, bool queryDirIsTail=true, const int* groundTruthTargets=nullptr, int numGroundTruth=0);
+    // implementation of both scoreMaxPlus(), Cands gives the candidates and their rules by position
+    template<class Cands>
+    void scoreMaxPlusCands(Cands& cands, std::vector<std::pair<int, double>>& aggregatedCand, TripleStorage& train, RuleStorage& rules, int queryRel, int querySource, bool queryDirIsTail, const int* groundTruthTargets, int numGroundTruth);
 
 
 
@@ -152,6 +163,24 @@ private:
     // when filtering with target, what we always do for KBC
     bool adapt_topk = false;
 
+    // memory in MB for the candidates of rules that are the same for every query (e.g. U_c rules)
+    // they are computed once per ranking instead of once per query, -1 for no limit, 0 for off
+    // fractions of a MB are possible (e.g. small budgets in tests)
+    double rank_cacheSizeMB = 256;
+
+    // maxplus only: stop the rule application of a query as soon as the remaining rules
+    // cannot change the topk candidates or their order anymore; replaces rank_discAtLeast and rank_numPreselect
+    bool rank_certifiedStop = false;
+    long long rank_numSkippedRules = 0;
+    long long rank_numCertifiedStops = 0;
+
+    // order all candidates of a query; if false only the first topk + num_true_answers are ordered
+    // (enough for writeRanking()), the others follow unordered and their score lists are not completed
+    // the candidates are always fully ordered when the rules are collected
+    bool rank_fullRanking = true;
+    // number of candidates that have to be ordered for a query, -1 for all
+    int numToOrder(int numGroundTruth);
+
 
     //***triple scoring options***
 
@@ -4,6 +4,7 @@
 #include <omp.h>
 #include <chrono>
 #include <numeric>
+#include <set>
 
 #include "core/Index.h"
 #include "core/TripleStorage.h"
@@ -891,10 +892,104 @@ void test_compute_strings(){
 
 }
 
+// the recursive DFS with a std::set for the object identity that the rules used before
+// reference for benchmark_dfs()
+void referenceSearch(
+    int currAtomIdx, int currEntity, std::set<int>& substitutions, TripleStorage& triples,
+    Nodes& closingEntities, std::vector<int>& rels, std::vector<bool>& dirs, int branchingFactor
+){
+    int* begin;
+    int length;
+    RowScratch::Scope scope;
+    dirs[currAtomIdx-1] ? triples.getTforHR(currEntity, rels[currAtomIdx], begin, length) : triples.getHforTR(currEntity, rels[currAtomIdx], begin, length);
+    if (currAtomIdx == rels.size()-1){
+        for (int i=0; i<length; i++){
+            if (substitutions.find(begin[i])==substitutions.end()){
+                closingEntities.insert(begin[i]);
+            }
+        }
+    }else{
+        if (branchingFactor>0 && length>branchingFactor){
+            return;
+        }
+        for (int i=0; i<length; i++){
+            int ent = begin[i];
+            if (substitutions.find(ent)==substitutions.end()){
+                substitutions.insert(ent);
+                referenceSearch(currAtomIdx+1, ent, substitutions, triples, closingEntities, rels, dirs, branchingFactor);
+                substitutions.erase(ent);
+            }
+        }
+    }
+}
+
+// tail queries of B rules with the DFS of the rules and with referenceSearch(), the predictions have to be the same
+void benchmark_dfs(){
+    std::shared_ptr<Index> index = std::make_shared<Index>();
+    std::string dataPath = "./data/wnrr/train.txt";
+    TripleStorage data(index);
+    data.read(dataPath);
+    std::shared_ptr<RuleFactory> ruleFactory = std::make_shared<RuleFactory>(index);
+
+    std::vector<std::string> ruleStrings = {
+        "_has_part(X,Y) <= _has_part(X,A), _member_of_domain_region(A,B), _member_of_domain_region(Y,B)",
+        "_hypernym(X,Y) <= _derivationally_related_form(X,A), _hypernym(A,B), _derivationally_related_form(Y,B)",
+        "_derivationally_related_form(X,Y) <= _derivationally_related_form(X,A), _derivationally_related_form(A,Y)",
+        "_member_meronym(X,Y) <= _member_meronym(X,A), _hypernym(A,B), _hypernym(Y,B)",
+        "_synset_domain_topic_of(X,Y) <= _hypernym(X,A), _synset_domain_topic_of(A,Y)"
+    };
+    double timeRules = 0;
+    double timeReference = 0;
+    QueryResults results;
+    for (std::string& ruleString : ruleStrings){
+        std::unique_ptr<Rule> rule = ruleFactory->parseAnytimeRule(ruleString);
+        std::vector<int>& rels = rule->getRelations();
+        std::vector<bool>& dirs = rule->getDirections();
+        int* starts;
+        int numStarts;
+        dirs[0] ? data.getHeads(rels[1], starts, numStarts) : data.getTails(rels[1], starts, numStarts);
+
+        // number and (order independent) checksum of the predictions
+        std::array<long long, 2> preds = {0, 0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i=0; i<numStarts; i++){
+            rule->predictTailQuery(starts[i], data, results);
+            for (int cand : results.getCandsOrdered()){
+                preds[0] += 1;
+                preds[1] += (long long) starts[i] * 31 + cand;
+            }
+            results.clear();
+        }
+        timeRules += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::array<long long, 2> referencePreds = {0, 0};
+        start = std::chrono::steady_clock::now();
+        for (int i=0; i<numStarts; i++){
+            Nodes closingEntities;
+            std::set<int> substitutions = {starts[i]};
+            referenceSearch(1, starts[i], substitutions, data, closingEntities, rels, dirs, rule->getBranchingFactor());
+            for (const int& cEnt : closingEntities){
+                results.insertRule(cEnt, rule.get());
+            }
+            for (int cand : results.getCandsOrdered()){
+                referencePreds[0] += 1;
+                referencePreds[1] += (long long) starts[i] * 31 + cand;
+            }
+            results.clear();
+        }
+        timeReference += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (preds != referencePreds){
+            throw std::runtime_error("DFS benchmark: different predictions for " + ruleString);
+        }
+    }
+    std::cout<<"DFS benchmark passed, rules: "<<timeRules<<"s, recursive reference: "<<timeReference<<"s"<<std::endl;
+}
+
 int main(){
     test_compute_strings();
     tests_groundings();
     tests();
     testTripleScoring();
+    benchmark_dfs();
     return 0;
 }
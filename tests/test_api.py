@@ -726,6 +726,382 @@ def test_loader():
     print("Test for loading idx's successful")
 
 
+def test_snapshot():
+    import c_clause
+    import tempfile
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        snapshot = join_u(tmp_dir, "wnrr.snapshot")
+        loader.write_snapshot(snapshot)
+
+        loader_snap = c_clause.Loader(options.get("loader"))
+        loader_snap.load_snapshot(snapshot)
+        loader_snap.load_rules(rules)
+
+        assert loader.get_entity_index() == loader_snap.get_entity_index()
+        assert loader.get_relation_index() == loader_snap.get_relation_index()
+
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        ranker_snap = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker_snap.calculate_ranking(loader_snap)
+        for direction in ["head", "tail"]:
+            assert ranker.get_ranking(direction, True) == ranker_snap.get_ranking(direction, True)
+
+        # loading twice is not allowed
+        try:
+            loader_snap.load_snapshot(snapshot)
+            assert False
+        except RuntimeError:
+            pass
+
+
+def test_shared_memory():
+    import c_clause
+    import os
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+    ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+    ranker.calculate_ranking(loader)
+
+    name = "pyclause_test_" + str(os.getpid())
+    loader.publish_shared(name)
+    loader_shared = c_clause.Loader(options.get("loader"))
+    loader_shared.attach_shared(name)
+    loader_shared.load_rules(rules)
+
+    assert loader.get_entity_index() == loader_shared.get_entity_index()
+    assert loader.get_relation_index() == loader_shared.get_relation_index()
+
+    # the publishing loader works on the segment as well
+    for l in [loader, loader_shared]:
+        ranker_shared = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker_shared.calculate_ranking(l)
+        for direction in ["head", "tail"]:
+            assert ranker.get_ranking(direction, True) == ranker_shared.get_ranking(direction, True)
+
+    # the name is taken while the segment is used
+    try:
+        other = c_clause.Loader(options.get("loader"))
+        other.load_data(data=train)
+        other.publish_shared(name)
+        assert False
+    except RuntimeError:
+        pass
+
+    # removed when the last loader is gone, handlers keep the index of the loader they used
+    del loader, loader_shared, ranker, ranker_shared
+    try:
+        c_clause.Loader(options.get("loader")).attach_shared(name)
+        assert False
+    except RuntimeError:
+        pass
+
+
+def test_add_data():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+
+    with open(train) as f:
+        triples = [line.strip().split("\t") for line in f if line.strip()]
+    half = len(triples) // 2
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+
+    # same ids in both loaders such that ties are broken the same way
+    entities = sorted(loader.get_entity_index().items(), key=lambda x: x[1])
+    relations = sorted(loader.get_relation_index().items(), key=lambda x: x[1])
+
+    # small threshold such that a compaction runs in the background while triples are added
+    options.set("loader.compaction_threshold", 1000)
+    loader_add = c_clause.Loader(options.get("loader"))
+    loader_add.set_entity_index([e for e, _ in entities])
+    loader_add.set_relation_index([r for r, _ in relations])
+    loader_add.load_data(data=triples[:half], filter=filter, target=target)
+    for i in range(half, len(triples), 5000):
+        loader_add.add_data(triples[i:i+5000])
+    loader_add.load_rules(rules)
+
+    ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+    ranker.calculate_ranking(loader)
+    ranker_add = c_clause.RankingHandler(options.get("ranking_handler"))
+    ranker_add.calculate_ranking(loader_add)
+    for direction in ["head", "tail"]:
+        assert ranker.get_ranking(direction, True) == ranker_add.get_ranking(direction, True)
+
+    loader_add.compact()
+    ranker_add.calculate_ranking(loader_add)
+    for direction in ["head", "tail"]:
+        assert ranker.get_ranking(direction, True) == ranker_add.get_ranking(direction, True)
+
+
+def test_entity_order():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    results = []
+    for order in ["none", "degree", "bfs", "rcm"]:
+        options.set("loader.entity_order", order)
+        loader = c_clause.Loader(options.get("loader"))
+        loader.load_data(data=train, filter=filter, target=target)
+        loader.load_rules(rules)
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        qa = c_clause.QAHandler(options.get("qa_handler"))
+        qa.calculate_answers([(0, 0), (1, 2), (17, 1)], loader, "tail")
+        results.append((
+            loader.get_entity_index(),
+            ranker.get_ranking("head", False),
+            ranker.get_ranking("tail", True),
+            qa.get_answers(False),
+        ))
+    # the internal ids are not visible
+    for result in results[1:]:
+        assert result == results[0]
+
+
+def test_compress_data():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    results = []
+    for compress in [False, True]:
+        options.set("loader.compress_data", compress)
+        loader = c_clause.Loader(options.get("loader"))
+        loader.load_data(data=train, filter=filter, target=target)
+        loader.load_rules(rules)
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        scorer = c_clause.PredictionHandler(options.get("prediction_handler"))
+        scorer.calculate_scores(target, loader)
+        results.append((ranker.get_ranking("tail", True), scorer.get_scores(True)))
+    assert results[1] == results[0]
+
+
+def test_d_body_index():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+
+    def rank_and_score(loader):
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        scorer = c_clause.PredictionHandler(options.get("prediction_handler"))
+        scorer.calculate_scores(target, loader)
+        return ranker.get_ranking("head", True), ranker.get_ranking("tail", True), scorer.get_scores(True)
+
+    results = []
+    for index in [False, True]:
+        options.set("loader.d_body_index", index)
+        loader = c_clause.Loader(options.get("loader"))
+        loader.load_data(data=train, filter=filter, target=target)
+        loader.load_rules(rules)
+        results.append(rank_and_score(loader))
+    assert results[1] == results[0]
+
+    # the index is built on half of the data; after add_data it is stale and the rules search the body
+    # until compact() builds it again
+    with open(train) as f:
+        triples = [line.strip().split("\t") for line in f if line.strip()]
+    half = len(triples) // 2
+    entities = sorted(loader.get_entity_index().items(), key=lambda x: x[1])
+    relations = sorted(loader.get_relation_index().items(), key=lambda x: x[1])
+
+    options.set("loader.d_body_index", True)
+    options.set("loader.compaction_threshold", -1)
+    loader_add = c_clause.Loader(options.get("loader"))
+    loader_add.set_entity_index([e for e, _ in entities])
+    loader_add.set_relation_index([r for r, _ in relations])
+    loader_add.load_data(data=triples[:half], filter=filter, target=target)
+    loader_add.load_rules(rules)
+    loader_add.add_data(triples[half:])
+    assert rank_and_score(loader_add) == results[0]
+    loader_add.compact()
+    assert rank_and_score(loader_add) == results[0]
+
+
+def test_closing_set_cache():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    options = Options()
+    options.set("ranking_handler.topk", 20)
+    options.set("ranking_handler.num_threads", 4)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+
+    results = []
+    # off, a budget of a few KB such that sets are dropped and computed again all the time, no limit
+    for cache_size in [0, 0.01, -1]:
+        options.set("ranking_handler.cache_size_mb", cache_size)
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        results.append((ranker.get_ranking("head", True), ranker.get_ranking("tail", True)))
+    assert results[1] == results[0]
+    assert results[2] == results[0]
+
+
+def test_certified_stop():
+    import c_clause
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    topk = 10
+    options = Options()
+    options.set("ranking_handler.topk", topk)
+    options.set("ranking_handler.aggregation_function", "maxplus")
+    # all rules are applied
+    options.set("ranking_handler.disc_at_least", -1)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+
+    results = []
+    for certified in [False, True]:
+        options.set("ranking_handler.certified_stop", certified)
+        ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+        ranker.calculate_ranking(loader)
+        results.append(ranker.get_ranking("tail", False))
+        stats = ranker.get_certified_stop_stats()
+        if certified:
+            # the stop fired and rules were left out
+            assert stats["stopped_queries"] > 0
+            assert stats["skipped_rules"] > 0
+        else:
+            assert stats["skipped_rules"] == 0
+
+    # the stop only keeps the topk candidates
+    for rel, queries in results[0].items():
+        for source, cands in queries.items():
+            assert results[1][rel][source][:topk] == cands[:topk]
+
+
+def test_full_ranking():
+    import c_clause
+    import tempfile
+
+    base_dir = get_base_dir()
+    train = join_u(base_dir, join_u("data", "wnrr", "train.txt"))
+    filter = join_u(base_dir, join_u("data", "wnrr", "valid.txt"))
+    target = join_u(base_dir, join_u("data", "wnrr", "test.txt"))
+    rules = join_u(base_dir, join_u("data", "wnrr", "anyburl-rules-c5-3600"))
+
+    topk = 10
+    options = Options()
+    options.set("ranking_handler.topk", topk)
+
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data(data=train, filter=filter, target=target)
+    loader.load_rules(rules)
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        for aggr in ["maxplus", "noisyor"]:
+            options.set("ranking_handler.aggregation_function", aggr)
+            written = []
+            for full in [True, False]:
+                options.set("ranking_handler.full_ranking", full)
+                ranker = c_clause.RankingHandler(options.get("ranking_handler"))
+                ranker.calculate_ranking(loader)
+                path = join_u(tmp_dir, f"ranking-{aggr}-{full}.txt")
+                ranker.write_ranking(path, loader)
+                with open(path) as f:
+                    written.append(f.read())
+                ranking = ranker.get_ranking("tail", False)
+                if full:
+                    full_ranking = ranking
+                else:
+                    # all candidates are returned, the first topk in the same order
+                    for rel, queries in full_ranking.items():
+                        for source, cands in queries.items():
+                            assert ranking[rel][source][:topk] == cands[:topk]
+                            assert sorted(ranking[rel][source]) == sorted(cands)
+            # the written ranking only needs the ordered candidates
+            assert written[0] == written[1]
+
+
+def test_replace_strings():
+    import c_clause
+
+    options = Options()
+    loader = c_clause.Loader(options.get("loader"))
+    loader.load_data([["a", "r", "b"], ["c", "r", "b"]])
+
+    # new names do not have to be unique, the name maps to the id of the last replaced key
+    loader.replace_ent_strings({"a": "x", "c": "x"})
+    loader.replace_rel_strings({"r": "rel"})
+    assert loader.get_entity_index() == {"x": 2, "b": 1}
+    assert loader.get_relation_index() == {"rel": 0}
+
+
 def test_triple_scoring():
     """
     Test if the triple scores with string output match the idx version.